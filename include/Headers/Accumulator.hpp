@@ -1,20 +1,23 @@
 class Accumulator {
     public:
-        Buffer<Point> BUFFER_L;
+        LiDARBuffer BUFFER_L;
         Buffer<IMU> BUFFER_I;
-        Buffer<State> BUFFER_X;
 
         double initial_time;
 
         // Add to buffer
-            void add(State, double time=-1);
             void add(IMU, double time=-1);
-            void add(Point, double time=-1);
-            void add(Points);
+            void add(Points&&);
 
-        // Receive from topics
+        // Receive from topics (ingestion threads)
             void receive_lidar(const PointCloud_msg&);
             void receive_imu(const IMU_msg&);
+
+        // Move received data to the buffers (processing thread)
+            void drain_queues();
+
+        // Block until the received data covers t, i.e. latest_time() >= t (processing thread)
+            void wait_data(double t, double timeout=0.1);
         
         // Empty buffers
             void clear_buffers();
@@ -22,13 +25,12 @@ class Accumulator {
             void clear_lidar(TimeType);
 
         // Get content given time intervals
+        // Views are only valid until the next add/clear of their buffer
 
-            State get_prev_state(double t);
             IMU get_next_imu(double t);
 
-            States get_states(double t1, double t2);
-            Points get_points(double t1, double t2);
-            IMUs get_imus(double t1, double t2);
+            PointsView get_points(double t1, double t2);
+            IMUsView get_imus(double t1, double t2);
 
             template <typename ContentType>
             int before_t(Buffer<ContentType>& source, double t) {
@@ -54,23 +56,44 @@ class Accumulator {
         bool is_ready = false;
         bool has_warned_lidar = false;
 
-        void push(const State&);
+        // Ingestion -> processing thread, one producer each
+        Queue<Points> QUEUE_L;
+        Queue<IMU> QUEUE_I;
+
+        // LiDAR messages are processed concurrently, then pushed in order to QUEUE_L
+        std::unique_ptr<PreprocessingPool> LIDAR_WORKERS;
+
+        // Wake-up of the processing thread
+        std::atomic<double> latest_received;
+        std::atomic<double> awaited_time;
+        std::mutex wake_mutex;
+        std::condition_variable wake_condition;
+        bool has_woken = false;
+        std::chrono::steady_clock::time_point woken_at;
+        std::chrono::steady_clock::time_point last_wait_end = std::chrono::steady_clock::now();
+
+        void wake(double received_time);
+
         void push(const IMU&);
-        void push(const Point&);
+        void push(Points&&);
 
         template <typename ContentType>
-        std::deque<ContentType> get(Buffer<ContentType>& source, double t1, double t2) {
-            std::deque<ContentType> result;
+        BufferView<ContentType> get(Buffer<ContentType>& source, double t1, double t2) {
+            const std::deque<ContentType>& content = source.content;
+            int N = content.size();
+
+            // Content (sorted new to old) between t1 and t2 is in [k_t2, k_t1)
             int k_t2 = std::max(0, before_t(source, t2));
+            while (k_t2 < N and content[k_t2].time > t2) ++k_t2;
 
-            // Get content between t1 from t2 sorted new to old
-            for (int k = k_t2; k < source.content.size(); ++k) {
-                ContentType cnt = source.content[k];
-                if (t1 > cnt.time) break;
-                if (t2 >= cnt.time) result.push_front(cnt);
-            }
+            int k_t1 = k_t2;
+            while (k_t1 < N and content[k_t1].time >= t1) ++k_t1;
 
-            return result;
+            // Same content sorted old to new
+            return BufferView<ContentType> (
+                content.crbegin() + (N - k_t1),
+                content.crbegin() + (N - k_t2)
+            );
         }
 
         template <typename ContentType>
@@ -83,9 +106,8 @@ class Accumulator {
 
             // Get rightest content left to t (sorted new to old)
             for (int k = k_t; k < source.content.size(); ++k) {
-                ContentType cnt = source.content[k];
-                ContentType next_cnt = source.content[k - 1];
-                if (t >= cnt.time) return next_cnt;
+                const ContentType& cnt = source.content[k];
+                if (t >= cnt.time) return source.content[k - 1];
             }
 
             return ContentType();
@@ -98,7 +120,7 @@ class Accumulator {
 
             // Get leftest (newest) content right (previous) to t (sorted new to old)
             for (int k = k_t; k >= 0; --k) {
-                ContentType cnt = source.content[k];
+                const ContentType& cnt = source.content[k];
                 if (t > cnt.time) return cnt;
             }
 
@@ -106,9 +128,6 @@ class Accumulator {
             return ContentType();
         }
 
-        // Process LiDAR pointcloud message
-        Points process(const PointCloud_msg&);
-
         bool enough_imus();
         void set_initial_time();
         double interpret_initialization(const InitializationParams&, double t);
@@ -124,7 +143,15 @@ class Accumulator {
         }
 
     private:
-        Accumulator() = default;
+        Accumulator() : QUEUE_L(1000), QUEUE_I(1000), latest_received(-DBL_MAX), awaited_time(DBL_MAX) {
+            this->LIDAR_WORKERS.reset(new PreprocessingPool(
+                Config.preprocessing_threads, 2*Config.preprocessing_threads,
+                [this](Points&& points) {
+                    if (not this->QUEUE_L.push(std::move(points)))
+                        ROS_WARN("LiDAR queue is full, dropping a pointcloud.");
+                }
+            ));
+        }
 
         // Delete copy/move so extra instances can't be created/moved.
         Accumulator(const Accumulator&) = delete;
@@ -2,12 +2,25 @@
 #define COMMON_H
 // Libraries
 #include <ros/ros.h>
+#include <ros/callback_queue.h>
 #include <iostream>
 #include <math.h>
 #include <chrono>
+#include <cstring>
+#include <algorithm>
+#include <numeric>
 // Data Structures
 #include <deque>
 #include <vector>
+#include <map>
+#include <unordered_map>
+// Concurrency
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <functional>
+#include <memory>
 // TF library
 #include <tf/transform_datatypes.h>
 #include <tf/transform_broadcaster.h>
@@ -53,6 +66,14 @@ struct InitializationParams {
     std::vector<double> deltas;
 };
 
+struct LiDARFieldsParams {
+    std::string intensity;
+    std::string time;
+    std::string range;
+    double time_unit;
+    bool relative_time;
+};
+
 struct Params {
     bool mapping_online;
     bool real_time;
@@ -72,6 +93,15 @@ struct Params {
     int downsample_rate;
     float downsample_prec;
     bool high_quality_publish;
+    bool downsample_before_deskew;
+    std::string downsample_mode;
+    int downsample_threads;
+    int range_image_columns;
+    float range_image_smoothness;
+    bool print_metrics;
+    int preprocessing_threads;
+    int threads;
+    std::vector<int> threads_affinity;
 
     double min_dist;
     std::string LiDAR_type;
@@ -89,6 +119,13 @@ struct Params {
     double MAX_DIST_PLANE;
     float PLANES_THRESHOLD;
     float PLANES_CHOOSE_CONSTANT;
+    float match_reuse_dist;
+    float match_cache_prec;
+    float map_planes_prec;
+    std::string map_backend;
+    float ivox_prec;
+    int ivox_neighbours;
+    int ivox_capacity;
 
     double wx_MULTIPLIER;
     double wy_MULTIPLIER;
@@ -104,6 +141,7 @@ struct Params {
     std::string imus_topic;
 
     InitializationParams Initialization;
+    LiDARFieldsParams LiDAR_fields;
 };
 
 namespace velodyne_ros {
@@ -138,19 +176,6 @@ namespace full_info {
   };
 }
 
-namespace custom {
-    // Example: point with lots of fields
-    struct EIGEN_ALIGN16 Point {
-        PCL_ADD_POINT4D;
-        PCL_ADD_RGB;
-        float intensity;
-        float range;
-        double timestamp;
-        uint16_t ring;
-        EIGEN_MAKE_ALIGNED_OPERATOR_NEW
-    };
-}
-
 namespace ouster_ros {
   struct EIGEN_ALIGN16 Point {
       PCL_ADD_POINT4D;
@@ -206,20 +231,6 @@ POINT_CLOUD_REGISTER_POINT_STRUCT(ouster_ros::Point,
     (std::uint32_t, range, range)
 )
 
-// Example: point with lots of fields
-POINT_CLOUD_REGISTER_POINT_STRUCT(custom::Point,
-    (float, x, x)
-    (float, y, y)
-    (float, z, z)
-    (float, r, r)
-    (float, g, g)
-    (float, b, b)
-    (float, intensity, intensity)
-    (float, range, range)
-    (double, timestamp, timestamp)
-    (std::uint16_t, ring, ring)
-)
-
 typedef sensor_msgs::PointCloud2::ConstPtr PointCloud_msg;
 typedef sensor_msgs::ImuConstPtr IMU_msg;
 typedef double TimeType;
@@ -228,11 +239,15 @@ class Point;
 class IMU;
 class State;
 class RotTransl;
-typedef std::deque<Point> Points;
+class Trajectory;
+typedef std::vector<Point> Points;
 typedef std::vector<Point, Eigen::aligned_allocator<Point>> PointVector;
 typedef std::deque<IMU> IMUs;
 typedef std::deque<State> States;
 
+template <typename ContentType> class BufferView;
+typedef BufferView<IMU> IMUsView;
+
 class Normal;
 class Plane;
 class Match;
@@ -240,6 +255,10 @@ typedef std::vector<Normal> Normals;
 typedef std::vector<Plane> Planes;
 typedef std::vector<Match> Matches;
 
+class PointsBlock;
+class PointsView;
+class LiDARBuffer;
+
 class Accumulator;
 class Localizator;
 class Mapper;
@@ -4,15 +4,52 @@ class Compensator {
 
         // Main constructor
         Points compensate(double t1, double t2);
-        Points compensate(const States& states, const State& Xt2, const Points& points);
+        Points compensate(const Trajectory& path, const RotTransl& Xt2_L, const PointsView& points);
+
+        // Downsample in the LiDAR frame first, then compensate the survivors
+        Points compensate_downsampled(double t1, double t2);
         
-        States path(double t1, double t2);
         Points downsample(const Points&);
 
     private:
-        State get_t2(const States&, double t2);
-        States upsample(const States&, const IMUs&);
+        // Motion of an IMU interval, folded with (Xt2 * I_Rt_L)^-1
+        //      p' = A * Exp(w*dt) * (RLI*p + tLI) + c0 + c1*dt + c2*dt^2
+        struct DeskewInterval {
+            TimeType time;
+            Eigen::Matrix3f A;
+            Eigen::Vector3f axis;
+            float ang_vel;
+            Eigen::Vector3f c0, c1, c2;
+            Eigen::Matrix3f RLI;
+            Eigen::Vector3f tLI;
+        };
+
+        // Deskewed points of the last window, in the frame of its (Xt2 * I_Rt_L)^-1 (mapping offline only)
+        struct DeskewCache {
+            bool valid = false;
+            TimeType t1, t2;
+            Eigen::Matrix3f R;
+            Eigen::Vector3f t;
+            Points points;
+        } cache;
+
+        bool cached(double t2, const RotTransl& Xt2_L) const;
+        Points take_cached(double t1);
+
+        // Batch being deskewed (SoA, reused between calls, one per pool thread)
+        struct DeskewBatch {
+            Eigen::ArrayXf X, Y, Z, DT;
+            Eigen::ArrayXf UX, UY, UZ, SIN, COS;
+        };
+        std::vector<DeskewBatch> batches;
+
+        DeskewInterval deskew_interval(const Trajectory::Sample&, const RotTransl& Xt2_L_inv);
+        void deskew(const DeskewInterval&, Point* points, int N, DeskewBatch&);
+
+        // Reused between windows
+        VoxelDownsampler voxel_filter;
 
         Points voxelgrid_downsample(const Points&);
+        Points sensor_downsample(const PointsView&);
         Points onion_downsample(const Points&);
 };
\ No newline at end of file
@@ -17,6 +17,9 @@ class Localizator {
 
     private:
         esekfom::esekf<state_ikfom, 12, input_ikfom> IKFoM_KF;
+
+        // IMU-rate states the filter went through
+        Trajectory path_taken;
     
     // Methods
 
@@ -26,16 +29,26 @@ class Localizator {
         
         void correct(const Points&, double time);
         void calculate_H(const state_ikfom&, const Matches&, Eigen::MatrixXd& H, Eigen::VectorXd& h);
+        void calculate_HTH(const state_ikfom&, const Matches&, Eigen::Matrix<double, 12, 12>& HTH, Eigen::Matrix<double, 12, 1>& HTh);
         
         void propagate_to(double t);
         State latest_state();
 
+        const Trajectory& trajectory() const;
+        void clear_trajectory(double t);
+
     private:
         void init_IKFoM();
         void init_IKFoM_state(const IMU& imu);
         void IKFoM_update(const Points&);
+
+        template <bool EstimateExtrinsics>
+        void accumulate_HTH(const state_ikfom&, const Matches&, Eigen::Matrix<double, 12, 12>& HTH, Eigen::Matrix<double, 12, 1>& HTh);
+        template <int Cols>
+        static void cross(const Eigen::Matrix<double, 3, Cols>& U, const Eigen::Matrix<double, 3, Cols>& V, Eigen::Matrix<double, 3, Cols>& UxV);
         
         void propagate(const IMU& imu);
+        void record(const IMU& imu);
         const state_ikfom& get_x() const;
         void set_orientation(const IMU& imu);
 
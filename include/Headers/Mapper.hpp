@@ -5,12 +5,112 @@
 #include "ikd_Tree.h"
 #endif
 
+// Point storage of the map, searched for the nearest neighbours of each point to localize
+class MapBackend {
+    public:
+        virtual ~MapBackend() = default;
+
+        // Downsample: skip points too close to the ones already in the map
+        virtual void add(const Points&, bool downsample) = 0;
+        virtual int size() = 0;
+
+        // Points it keeps memory for: nodes (deleted ones too) or voxel slots
+        virtual int reserved() = 0;
+
+        // Up to k nearest points sorted by distance, with their squared distances (called concurrently)
+        virtual void knn(const Point&, int k, PointVector& near_points, std::vector<float>& sq_dists) = 0;
+};
+
+// ikd-Tree: incremental k-d tree, rebalanced as it grows
+class IkdTreeMap : public MapBackend {
+    public:
+        IkdTreeMap(float delete_param, float balance_param, float box_length);
+
+        void add(const Points&, bool downsample) override;
+        int size() override;
+        int reserved() override;
+        void knn(const Point&, int k, PointVector& near_points, std::vector<float>& sq_dists) override;
+
+    private:
+        KD_TREE<Point>::Ptr tree;
+};
+
+// iVox: hashed voxel grid with a small array of points per voxel, O(1) inserts and no rebalancing
+class IVoxMap : public MapBackend {
+    public:
+        // Neighbours searched: 7 (voxel and its faces) or 27 (whole cube around it)
+        IVoxMap(float voxel_size, int neighbours, int capacity, float min_dist);
+
+        void add(const Points&, bool downsample) override;
+        int size() override;
+        int reserved() override;
+        void knn(const Point&, int k, PointVector& near_points, std::vector<float>& sq_dists) override;
+
+    private:
+        float inv_voxel_size;
+        int capacity;           // Points per voxel
+        float min_sq_dist;      // Between points of a voxel if downsampling
+        int Npoints = 0;
+
+        std::unordered_map<std::uint64_t, int> index;     // Voxel key -> voxels
+        std::vector<PointVector> voxels;
+        std::vector<Eigen::Vector3i> offsets;
+
+        Eigen::Vector3i coords(const Point&) const;
+};
+
 class Mapper {
     public:
         double last_map_time = -1;
 
     private:
-        KD_TREE<Point>::Ptr map;
+        std::unique_ptr<MapBackend> map;
+
+        // Plane each point of the current localization was matched to, reused between IEKF iterations
+        struct CachedMatch {
+            enum Source { Reused, Voxel, Recent, Searched };
+
+            bool searched = false;
+            Source source;
+            Point point;    // Where it is now
+            Point query;    // Where its neighbours were searched
+            float reach;    // Distance from the query to its farthest neighbour (if searched)
+            Plane plane;
+        };
+        std::vector<CachedMatch> cached_matches;
+
+        // Planes found by the last windows, by voxel of their query
+        // Erased when points are added to their support: the box around the query reaching its farthest neighbour
+        struct RecentPlane {
+            Plane plane;
+            int window;     // Last window it was used in
+            Eigen::Vector3f support_min, support_max;
+        };
+        std::unordered_map<std::uint64_t, RecentPlane> recent_planes;
+
+        // Recent planes whose support touches each cell of MAX_DIST_PLANE (it can still list erased ones)
+        std::unordered_map<std::uint64_t, std::vector<std::uint64_t>> recent_support;
+        int window = 0;
+        static constexpr int RECENT_WINDOWS = 100;
+
+        // Next buckets to look for old planes (and their erased keys) in
+        std::size_t swept_plane = 0;
+        std::size_t swept_cell = 0;
+
+        // Plane of the map's points in each voxel, refitted from their moments when points are added to it
+        struct MapVoxel {
+            int count = 0;
+            Eigen::Vector3d sum = Eigen::Vector3d::Zero();
+            Eigen::Matrix3d outer = Eigen::Matrix3d::Zero();     // Sum of p*p^T
+
+            Plane plane;
+            float rms = 0;      // Of the distances to the plane
+            bool dirty = false;
+        };
+        std::unordered_map<std::uint64_t, MapVoxel> map_planes;
+
+        // Batched plane fits, one per pool thread
+        std::vector<PlaneFitter> fitters;
 
     public:
         Mapper();
@@ -20,15 +120,18 @@ class Mapper {
         void add(Points&, double time, bool downsample=false);        
         void add(const State&, Points&, bool downsample=false);        
         Matches match(const State&, const Points&);
+        void forget_matches();
         bool hasToMap(double t);
 
     private:
-        void init_tree();
-        void build_tree(Points&);
-        bool exists_tree();
-
-        void add_points(Points&, bool downsample=false);
-        Match match_plane(const Point&);
+        void init_map();
+        void remember_planes();
+        void add_support(std::uint64_t key, const RecentPlane&);
+        void forget_planes(const Points&);
+        bool is_recent(const RecentPlane&) const;
+        void sweep_recent_planes();
+        void add_to_voxels(const Points&);
+        void fit_voxel(MapVoxel&);
 
     // Singleton pattern
     public:
@@ -17,6 +17,47 @@ class Buffer {
         void clear(TimeType t);
 };
 
+// Lock-free single-producer/single-consumer bounded queue
+template <typename ContentType>
+class Queue {
+    public:
+        Queue(int capacity);
+
+        // Only called from the producer thread, false if full
+        bool push(ContentType&& cnt);
+        // Only called from the consumer thread, false if empty
+        bool pop(ContentType& cnt);
+
+    private:
+        std::vector<ContentType, Eigen::aligned_allocator<ContentType>> slots;
+        std::atomic<size_t> head;   // Next to pop, owned by the consumer
+        char padding[64];           // Keep head and tail on different cache lines
+        std::atomic<size_t> tail;   // Next to push, owned by the producer
+};
+
+// Read-only view of a Buffer's content (sorted old to new)
+// Lifetime: valid until the next push, pop or clear of its Buffer
+template <typename ContentType>
+class BufferView {
+    public:
+        typedef typename std::deque<ContentType>::const_reverse_iterator iterator;
+
+        BufferView(iterator first, iterator last) : first(first), last(last) {}
+
+        iterator begin() const { return this->first; }
+        iterator end() const { return this->last; }
+
+        const ContentType& operator[](int k) const { return this->first[k]; }
+        const ContentType& front() const { return *this->first; }
+        const ContentType& back() const { return *std::prev(this->last); }
+        bool empty() const { return this->first == this->last; }
+        int size() const { return this->last - this->first; }
+
+    private:
+        iterator first;
+        iterator last;
+};
+
 class Point {
     public:
         float x;
@@ -34,22 +75,6 @@ class Point {
         // Delegate constructor (Eigen + attributes)
         Point(const Eigen::Matrix<float, 3, 1>& p, const Point& attributes);
         
-        // HESAI specific
-            Point(const hesai_ros::Point& p);
-            Point(const hesai_ros::Point& p, double time_offset);
-
-        // Velodyne specific
-            Point(const velodyne_ros::Point& p);
-            Point(const velodyne_ros::Point& p, double time_offset);
-        
-        // Ouster specific
-            Point(const ouster_ros::Point& p);
-            Point(const ouster_ros::Point& p, double time_offset);
-
-        // Custom specific
-            Point(const custom::Point& p);
-            Point(const custom::Point& p, double time_offset);
-
         full_info::Point toPCL() const;
         Eigen::Matrix<float, 3, 1> toEigen() const;
 
@@ -69,12 +94,76 @@ class Point {
         template <typename PointType>
         void set_attributes(const PointType& p);
 
-        // Ouster specific
-        void set_attributes(const ouster_ros::Point& p);
+        void pass_attributes(const Point& attributes);
+};
+
+// Time-sorted points of a single LiDAR message, stored contiguously
+class PointsBlock {
+    public:
+        Points points;
+        TimeType begin;
+        TimeType end;
+
+        PointsBlock(Points&& time_sorted_points);
+};
+
+// Read-only view of the points of one or more PointsBlock (sorted old to new)
+// Lifetime: valid until the blocks it spans are dropped from their LiDARBuffer
+class PointsView {
+    public:
+        typedef std::pair<const Point*, const Point*> Span;
+        std::vector<Span> spans;
+
+        // Only set when overlapping blocks had to be merged, then the view spans it
+        std::shared_ptr<const Points> merged;
+
+        class iterator {
+            public:
+                iterator(const std::vector<Span>* spans, int s, const Point* p) : spans(spans), s(s), p(p) {}
+
+                const Point& operator*() const { return *p; }
+                const Point* operator->() const { return p; }
+                bool operator==(const iterator& other) const { return p == other.p; }
+                bool operator!=(const iterator& other) const { return p != other.p; }
+
+                iterator& operator++() {
+                    if (++p == (*spans)[s].second and ++s < spans->size()) p = (*spans)[s].first;
+                    return *this;
+                }
+
+            private:
+                const std::vector<Span>* spans;
+                int s;
+                const Point* p;
+        };
+
+        PointsView() = default;
+        PointsView(const Points&);
+
+        iterator begin() const;
+        iterator end() const;
         
-        // Point::set_attributes(const custom::Point& p);
+        const Point& front() const;
+        const Point& back() const;
+        bool empty() const;
+        int size() const;
+};
 
-        void pass_attributes(const Point& attributes);
+class LiDARBuffer {
+    public:
+        // One block per message sorted by begin, blocks of different LiDARs can overlap in time
+        std::deque<PointsBlock> blocks;
+        LiDARBuffer();
+
+        void push(Points&& time_sorted_points);
+        PointsView get(TimeType t1, TimeType t2) const;
+        bool empty() const;
+        int size() const;
+        void clear();
+        void clear(TimeType t);
+
+    private:
+        PointsView merge(const PointsView& overlapping) const;
 };
 
 class IMU {
@@ -150,6 +239,46 @@ class RotTransl {
         friend Points operator* (const RotTransl&, const Points&);
 };
 
+class Trajectory {
+    public:
+        // Pose at an IMU time and the constant rates until the next one
+        struct Sample {
+            TimeType time;
+            Eigen::Matrix3f R;
+            Eigen::Vector3f pos;
+            Eigen::Vector3f vel;
+            Eigen::Vector3f acc;    // R*(a - ba) - g
+            Eigen::Vector3f axis;   // (w - bw)/|w - bw|
+            float ang_vel;          // |w - bw|
+
+            // Offsets
+            Eigen::Matrix3f RLI;
+            Eigen::Vector3f tLI;
+
+            Sample(const State&);
+        };
+
+        // Sorted old to new, contiguous
+        std::vector<Sample> samples;
+
+        Trajectory() = default;
+        Trajectory(const States&);
+
+        // Samples at or after the state's time are replaced
+        void push(const State&);
+        bool empty() const;
+        int size() const;
+        void clear();
+        void clear(TimeType t);
+
+        // Last sample at or before t (the first one if t is before all of them)
+        int index(TimeType t) const;
+
+        // Interpolated poses at t
+        RotTransl pose(TimeType t) const;
+        RotTransl lidar_pose(TimeType t) const;
+};
+
 class Normal {
     public:
         float A, B, C, D;
@@ -168,14 +297,34 @@ class Plane {
         Normal n;
         
         Plane();
-        Plane(const PointVector&, const std::vector<float>&);
         float dist_to_plane(const Point&) const;
         bool on_plane(const Point&);
+};
+
+// Fits the planes of many neighbour sets at once, one query per column (SoA)
+class PlaneFitter {
+    public:
+        // Start a new batch of queries with k neighbours each
+        void reset(int k);
+
+        // Neighbours of the next query (it can only be a plane if there are k of them and they're close enough)
+        void add(const PointVector& near_points, const std::vector<float>& sq_dists);
+        int size() const;
+
+        // Planes of the queries, in the order they were added
+        const std::vector<Plane>& fit(float threshold);
 
     private:
-        bool enough_points(const PointVector&);
-        bool points_close_enough(const std::vector<float>&);
-        void fit_plane(const PointVector&);
+        int k = 0;
+        int N = 0;
+        Eigen::ArrayXXd X, Y, Z;    // k x capacity
+        std::vector<char> valid;
+        std::vector<Plane> planes;
+
+        // Specialized for the usual number of neighbours, any other one is fitted query by query
+        template <int K>
+        void fit_kernel(float threshold);
+        void fit_each(float threshold);
 };
 
 class Match {
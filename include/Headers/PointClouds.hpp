@@ -1,32 +1,188 @@
+// How to read the points of a LiDAR's PointCloud2 (x, y, z are always float32)
+struct LiDARSchema {
+    std::string intensity_field;
+    std::string time_field;
+    std::string range_field;    // Empty: range := |(x, y, z)|
+    double time_unit;           // Seconds per raw time unit
+    bool relative_time;         // Relative to the message's stamp (true) or absolute (false)
+};
+
+// Which points to keep while decoding
+struct DecodeFilter {
+    int rate;           // Keep one every 'rate' points
+    double min_dist;    // Discard points closer than this
+};
+
+class RangeImage {
+
+    // Organized scan: rings x azimuth columns, each cell with the index of its point
+
+    public:
+        int rings = 0;
+        int columns;
+        std::vector<int> cells;     // -1 if empty
+
+        // Rings out of [0, MAX_RINGS) are dropped while decoding
+        static constexpr int MAX_RINGS = 256;
+        static bool valid_ring(double ring);
+
+        RangeImage(int columns);
+
+        void fill(const Points&, const std::vector<int>& point_rings);
+        int at(int ring, int column) const;
+        int column(const Point&) const;
+
+        // Column by column from the first point, in the sensor's spin direction (~time order): one
+        // every filter.rate columns, far enough and (if smoothness > 0) with a range similar to their ring neighbours'
+        Points filter(const Points&, const DecodeFilter&, float smoothness) const;
+
+    private:
+        bool is_smooth(const Points&, int ring, int column, float smoothness) const;
+        int spin(const Points&, const Point& first) const;
+};
+
+class LiDARDriver {
+
+    // Given the LiDAR type, decode its PointCloud2 messages
+
+    public:
+        typedef Points (*Kernel)(const PointCloud_msg&, const LiDARSchema&, const DecodeFilter&, std::vector<int>* rings);
+
+        LiDARSchema schema;
+        Kernel kernel = nullptr;
+
+        Points decode(const PointCloud_msg&, const DecodeFilter& = DecodeFilter {1, -1.}) const;
+        bool exists() const;
+
+    private:
+        // Known LiDARs: specialized at compile time for their driver's layout
+        template <typename LayoutType>
+        static Points layout_kernel(const PointCloud_msg&, const LiDARSchema&, const DecodeFilter&, std::vector<int>* rings);
+
+        // Unknown LiDARs: fields read at runtime as given in the YAML
+        static Points schema_kernel(const PointCloud_msg&, const LiDARSchema&, const DecodeFilter&, std::vector<int>* rings);
+
+        void resolve(const std::string& LiDAR_type);
+        void set(const LiDARSchema&, Kernel);
+
+    // Singleton pattern
+    public:
+        static LiDARDriver& getInstance() {
+            static LiDARDriver* driver = new LiDARDriver();
+            return *driver;
+        }
+
+    private:
+        LiDARDriver();
+
+        // Delete copy/move so extra instances can't be created/moved.
+        LiDARDriver(const LiDARDriver&) = delete;
+        LiDARDriver& operator=(const LiDARDriver&) = delete;
+        LiDARDriver(LiDARDriver&&) = delete;
+        LiDARDriver& operator=(LiDARDriver&&) = delete;
+};
+
 class PointCloudProcessor {
     
     // Given a PointCloud, process it to push to the buffer
 
     public:
         PointCloudProcessor() = default;
-        Points msg2points(const PointCloud_msg&);
-        Points downsample(const Points&);
-        Points sort_points(const Points&);
+        Points process(const PointCloud_msg&);
+        void sort_points(Points&);
 
     private:
-        // Velodyne specific
-            Points velodynemsg2points(const PointCloud_msg&);
-            double get_begin_time(const pcl::PointCloud<velodyne_ros::Point>&);
-        
-        // HESAI specific
-            Points hesaimsg2points(const PointCloud_msg&);
-            double get_begin_time(const pcl::PointCloud<hesai_ros::Point>&);
-        
-        // Ouster specific
-            Points oustermsg2points(const PointCloud_msg&);
-            double get_begin_time(const pcl::PointCloud<ouster_ros::Point>&);
-
-        // Custom specific
-            Points custommsg2points(const PointCloud_msg&);
-            double get_begin_time(const pcl::PointCloud<custom::Point>&);
-        
-        template <typename PointType> Points to_points(const typename pcl::PointCloud<PointType>&);
-
-        Points temporal_downsample(const Points&);
         static bool time_sort(const Point&, const Point&);
+        std::vector<int> time_runs(const Points&);
+        void merge_runs(Points&, std::vector<int>& runs);
+};
+
+class PreprocessingPool {
+
+    // Process LiDAR messages concurrently on the shared ThreadPool, hand them over in order of arrival
+
+    public:
+        typedef std::function<void(Points&&)> Output;
+
+        PreprocessingPool(int threads, int capacity, Output);
+        ~PreprocessingPool();
+
+        // Blocks while 'capacity' messages are already being processed
+        void submit(const PointCloud_msg&);
+
+    private:
+        struct Job {
+            long sequence;
+            PointCloud_msg msg;
+        };
+
+        Output output;
+        int threads;
+        int capacity;
+
+        // Shared by all threads
+        std::mutex mtx;
+        std::condition_variable space_condition;
+        std::condition_variable idle_condition;
+        std::deque<Job> jobs;
+        std::map<long, Points> processed;     // Reorder stage, waiting for older ones
+        long next_submitted = 0;
+        long next_released = 0;
+        int running = 0;                      // Pool tasks processing jobs
+        bool stopping = false;
+
+        void work();
+        void release(long sequence, Points&&);
+};
+
+class VoxelDownsampler {
+
+    // One point per voxel, hashing voxel keys in open-addressing tables reused between calls
+
+    public:
+        enum Mode { Centroid, First };
+
+        VoxelDownsampler() = default;
+
+        // Centroid: average of the voxel's points. First: first point of the voxel (keeps its attributes)
+        // With one thread, voxels are output in order of their first point
+        Points filter(const PointsView&, float precision, Mode, int threads=1);
+
+        // Integer coordinates of the voxel of side 1/inv_precision containing the point
+        static std::uint64_t key(const Point&, float inv_precision);
+        static std::uint64_t key(std::int64_t i, std::int64_t j, std::int64_t k);
+
+    private:
+        struct Voxel {
+            Point first;
+            double x, y, z, time, intensity, range;
+            int count;
+        };
+
+        struct Table {
+            std::vector<std::uint64_t> keys;
+            std::vector<std::uint32_t> generations;     // Slot is empty if != generation
+            std::vector<int> slots;                     // Slot -> voxel
+            std::vector<Voxel> voxels;
+            std::uint32_t generation = 0;
+            int mask = 0;
+
+            void reset(int max_voxels);
+            Voxel& find(std::uint64_t key, const Point&);
+        };
+
+        // One per thread, each one with a partition of the voxels
+        std::vector<Table> tables;
+
+        // Per input point (reused between calls): its key, partition and where it is, then the points grouped by partition
+        std::vector<std::uint64_t> keys;
+        std::vector<int> partitions;
+        std::vector<const Point*> inputs;
+        std::vector<int> grouped;
+        std::vector<int> counts;        // Chunks x partitions
+
+        void filter_partitions(const PointsView&, float inv_precision, Mode, int threads);
+        static void accumulate(Voxel&, const Point&, Mode);
+        static std::uint64_t hash(std::uint64_t key);
+        static int partition(std::uint64_t key, int threads);
 };
\ No newline at end of file
@@ -14,6 +14,7 @@ class Publishers {
         ros::Publisher gt_pub;
 
         double last_transform_time = -1;
+        std::chrono::steady_clock::time_point last_metrics_time = std::chrono::steady_clock::now();
 
         Publishers() {
             this->only_couts = true;
@@ -44,6 +45,10 @@ class Publishers {
             this->publish_states(states);
         }
 
+        void trajectory(const Trajectory& path) {
+            if (not this->only_couts) this->publish_trajectory(path);
+        }
+
         void planes(const Planes& planes) {
             this->publish_planes(planes);
         }
@@ -78,6 +83,15 @@ class Publishers {
             this->cout_extrinsics(state);
         }
 
+        void metrics(Metrics& metrics) {
+            // Print (and restart) averages every second
+            auto now = std::chrono::steady_clock::now();
+            if (now - this->last_metrics_time < std::chrono::seconds(1)) return;
+            this->last_metrics_time = now;
+
+            this->cout_metrics(metrics.take());
+        }
+
     private:
         bool only_couts;
 
@@ -89,6 +103,20 @@ class Publishers {
             std::cout << "-----------" << std::endl;
         }
 
+        void cout_metrics(const std::map<std::string, Metrics::Stats>& stats) {
+            std::ios_base::fmtflags flags = std::cout.flags();
+            std::streamsize precision = std::cout.precision();
+
+            std::cout << "-----------" << std::endl;
+            for (const auto& metric : stats) {
+                const Metrics::Stats& st = metric.second;
+                std::cout << std::fixed << std::setprecision(2) << metric.first << ": " << st.sum/st.count << " (max: " << st.max << ")" << std::endl;
+            }
+
+            std::cout.flags(flags);
+            std::cout.precision(precision);
+        }
+
         void publish_planes(const Planes& planes) {
             geometry_msgs::PoseArray normalPoseArray;
             normalPoseArray.header.frame_id = "map";
@@ -171,6 +199,33 @@ class Publishers {
             if (this->states_pub.getNumSubscribers() > 0) this->states_pub.publish(msg);
         }
 
+        void publish_trajectory(const Trajectory& path) {
+            if (path.empty() or this->states_pub.getNumSubscribers() == 0) return;
+
+            geometry_msgs::PoseArray msg;
+            msg.header.frame_id = "map";
+            msg.header.stamp = ros::Time(path.samples.back().time);
+            msg.poses.reserve(path.size());
+
+            for (const Trajectory::Sample& sample : path.samples) {
+                geometry_msgs::Pose pose;
+
+                pose.position.x = sample.pos(0);
+                pose.position.y = sample.pos(1);
+                pose.position.z = sample.pos(2);
+
+                Eigen::Quaternionf q(sample.R * sample.RLI);
+                pose.orientation.x = q.x();
+                pose.orientation.y = q.y();
+                pose.orientation.z = q.z();
+                pose.orientation.w = q.w();
+
+                msg.poses.push_back(pose);
+            }
+
+            this->states_pub.publish(msg);
+        }
+
         void publish_state(const State& state) {
             nav_msgs::Odometry msg;
             msg.header.stamp = ros::Time(state.time);
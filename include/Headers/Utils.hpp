@@ -85,4 +85,111 @@ public:
     }
 };
 
-typedef Timer<std::chrono::microseconds, std::chrono::steady_clock> MicroTimer;
\ No newline at end of file
+typedef Timer<std::chrono::microseconds, std::chrono::steady_clock> MicroTimer;
+
+// Runtime metrics of the pipeline (added from any thread)
+class Metrics {
+    public:
+        struct Stats {
+            double sum = 0;
+            double max = 0;
+            int count = 0;
+        };
+
+        void add(const std::string& name, double value);
+        void clear();
+
+        // Get the stats gathered so far and restart them
+        std::map<std::string, Stats> take();
+
+    private:
+        std::map<std::string, Stats> stats;
+        std::mutex mtx;
+
+    // Singleton pattern
+    public:
+        static Metrics& getInstance() {
+            static Metrics* metrics = new Metrics();
+            return *metrics;
+        }
+
+    private:
+        Metrics() = default;
+
+        // Delete copy/move so extra instances can't be created/moved.
+        Metrics(const Metrics&) = delete;
+        Metrics& operator=(const Metrics&) = delete;
+        Metrics(Metrics&&) = delete;
+        Metrics& operator=(Metrics&&) = delete;
+};
+
+// Process-wide workers shared by every parallel stage of the pipeline (sized at runtime)
+// Each worker has its own queue of tasks and steals from the others' when it runs out
+class ThreadPool {
+    public:
+        // (first, last, thread): chunk [first, last) run by 'thread', in [0, size())
+        typedef std::function<void(int, int, int)> Body;
+
+        // Create the workers once, before using it: 'threads' including the caller's (0 uses every given CPU, or every core)
+        // If CPUs are given, worker k is pinned to cpus[k % cpus.size()] and the caller to all of them, which the threads
+        // it creates later inherit. Threads created before (e.g. by ROS) aren't, confine the process (taskset) to hold them too
+        void start(int threads, const std::vector<int>& cpus = {});
+
+        // Threads that can run a parallel_for at once (workers + caller)
+        int size() const;
+
+        // Split [0, N) in chunks of 'grain' and run them concurrently, the caller helps and waits for all of them
+        // A thread index never runs two chunks at once (the caller is 0 if it isn't a worker)
+        void parallel_for(int N, int grain, const Body& body);
+
+        // Run a task on a worker without waiting for it (on the caller if there are no workers)
+        void submit(std::function<void()> task);
+
+    private:
+        typedef std::function<void()> Task;
+
+        struct Worker {
+            std::thread thread;
+            std::mutex mtx;
+            std::deque<Task> tasks;
+        };
+
+        // Chunks are taken in order by whoever runs first (caller or helpers)
+        struct Loop {
+            const Body* body;
+            int N, grain, chunks;
+            std::atomic<int> next;
+            std::atomic<int> done;
+        };
+
+        std::vector<std::unique_ptr<Worker>> workers;
+        std::atomic<int> pending;
+        std::atomic<int> next_worker;
+        std::mutex sleep_mtx;
+        std::condition_variable sleep_condition;
+
+        void work(int k);
+        void push(int k, Task&& task);
+        bool pop(int k, Task& task);
+        static bool run_chunk(Loop& loop, int thread);
+        static void pin(std::thread::native_handle_type thread, const std::vector<int>& cpus);
+
+        // Index of the calling thread: 0 outside the workers, k + 1 for worker k
+        static thread_local int current_thread;
+
+    // Singleton pattern
+    public:
+        static ThreadPool& getInstance() {
+            static ThreadPool* pool = new ThreadPool();
+            return *pool;
+        }
+
+    private:
+        ThreadPool() : pending(0), next_worker(0) {}
+
+        // Delete copy/move so extra instances can't be created/moved.
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+        ThreadPool(ThreadPool&&) = delete;
+        ThreadPool& operator=(ThreadPool&&) = delete;
+};
@@ -16,42 +16,74 @@ extern struct Params Config;
 // class Accumulator
     // public:
         // Add content to buffer
-            void Accumulator::add(State cnt, double time) {
-                if (time > 0) cnt.time = time;
-                this->push(cnt);
-            }
-
             void Accumulator::add(IMU cnt, double time) {
                 if (time > 0) cnt.time = time;
                 this->push(cnt);
             }
 
-            void Accumulator::add(Point cnt, double time) {
-                if (time > 0) cnt.time = time;
-                this->push(cnt);
-            }
-
-            void Accumulator::add(Points points) {
-                for (Point p : points) this->push(p);
+            void Accumulator::add(Points&& time_sorted_points) {
+                this->push(std::move(time_sorted_points));
             }
 
         // Receive from topics
             void Accumulator::receive_lidar(const PointCloud_msg& msg) {
-                // Turn message to processed points
-                Points points = this->process(msg);
-                
-                // Check if missing data
-                if (this->missing_data(points)) this->throw_warning(points);
-
-                // Add them individually on the LiDAR buffer
-                for (Point p : points) this->add(p);
+                // Turn message to processed points on a worker, they reach QUEUE_L in order
+                this->LIDAR_WORKERS->submit(msg);
             }
 
             void Accumulator::receive_imu(const IMU_msg& msg) {
                 // Turn message to IMU object
                 IMU imu(msg);
-                // Add it to the IMU buffer
-                this->add(imu);
+                
+                // Hand it to the processing thread
+                double time = imu.time;
+                if (not this->QUEUE_I.push(std::move(imu)))
+                    ROS_WARN("IMU queue is full, dropping an IMU.");
+                else this->wake(time);
+            }
+
+            void Accumulator::drain_queues() {
+                // Add them to the IMU buffer
+                IMU imu;
+                while (this->QUEUE_I.pop(imu)) this->add(imu);
+
+                Points points;
+                while (this->QUEUE_L.pop(points)) {
+                    // Check if missing data
+                    if (this->missing_data(points)) this->throw_warning(points);
+
+                    // Add them as a single block on the LiDAR buffer
+                    this->add(std::move(points));
+                }
+            }
+
+            void Accumulator::wait_data(double t, double timeout) {
+                auto begin = std::chrono::steady_clock::now();
+
+                // Tell the IMU thread what we are waiting for, then check if it already came
+                this->awaited_time.store(t);
+                std::unique_lock<std::mutex> lock(this->wake_mutex);
+                bool covered = this->latest_received.load() - Config.real_time_delay >= t;
+
+                if (not covered) {
+                    this->wake_condition.wait_for(
+                        lock, std::chrono::duration<double>(timeout),
+                        [this] { return this->has_woken; }
+                    );
+                }
+
+                auto end = std::chrono::steady_clock::now();
+
+                // Metrics: wake-to-start latency (if woken by new data) and idle time since last wait
+                Metrics& metrics = Metrics::getInstance();
+                if (this->has_woken) metrics.add("Loop - Wake-up latency (us)", std::chrono::duration<double, std::micro>(end - this->woken_at).count());
+                double idle = std::chrono::duration<double>(end - begin).count();
+                double busy = std::chrono::duration<double>(begin - this->last_wait_end).count();
+                if (idle + busy > 0) metrics.add("Loop - Idle CPU (%)", 100.*idle/(idle + busy));
+
+                this->last_wait_end = end;
+                this->has_woken = false;
+                this->awaited_time.store(DBL_MAX);
             }
 
         // Empty buffers
@@ -71,30 +103,15 @@ extern struct Params Config;
 
         /////////////////////////////////
 
-        State Accumulator::get_prev_state(double t) {
-            if (this->BUFFER_X.empty()) {
-                State X = Localizator::getInstance().latest_state();
-                Accumulator::getInstance().add(X, t);
-                X.time = t;
-                return X;
-            }
-            
-            return this->get_prev(this->BUFFER_X, t);
-        }
-
         IMU Accumulator::get_next_imu(double t) {
             return this->get_next(this->BUFFER_I, t);
         }
 
-        States Accumulator::get_states(double t1, double t2) {
-            return this->get(this->BUFFER_X, t1, t2);
+        PointsView Accumulator::get_points(double t1, double t2) {
+            return this->BUFFER_L.get(t1, t2);
         }
 
-        Points Accumulator::get_points(double t1, double t2) {
-            return this->get(this->BUFFER_L, t1, t2);
-        }
-
-        IMUs Accumulator::get_imus(double t1, double t2) {
+        IMUsView Accumulator::get_imus(double t1, double t2) {
             return this->get(this->BUFFER_I, t1, t2);
         }
 
@@ -136,19 +153,20 @@ extern struct Params Config;
 
     // private:
 
-        void Accumulator::push(const State& state) { this->BUFFER_X.push(state); }
         void Accumulator::push(const IMU& imu) { this->BUFFER_I.push(imu); }
-        void Accumulator::push(const Point& point) { this->BUFFER_L.push(point); }
-
-        Points Accumulator::process(const PointCloud_msg& msg) {
-            // Create a temporal object to process the pointcloud message
-            PointCloudProcessor processor;
-            Points points = processor.msg2points(msg);
-            Points downsampled_points = processor.downsample(points);
-            Points sorted_points = processor.sort_points(downsampled_points);
-            
-            // Return sorted (downsampled) points as "processed points"
-            return sorted_points;
+        void Accumulator::push(Points&& points) { this->BUFFER_L.push(std::move(points)); }
+
+        void Accumulator::wake(double received_time) {
+            this->latest_received.store(received_time);
+            if (received_time - Config.real_time_delay < this->awaited_time.load()) return;
+
+            {
+                std::lock_guard<std::mutex> lock(this->wake_mutex);
+                this->has_woken = true;
+                this->woken_at = std::chrono::steady_clock::now();
+            }
+
+            this->wake_condition.notify_one();
         }
 
         bool Accumulator::enough_imus() {
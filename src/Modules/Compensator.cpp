@@ -19,147 +19,212 @@ extern struct Params Config;
             // Call Accumulator
             Accumulator& accum = Accumulator::getInstance();
 
-            // Points from t1 to t2
-            Points points = accum.get_points(t1, t2);
-            if (points.empty()) return Points();
+            // IMU-rate states the Localizator propagated through
+            const Trajectory& path_taken = Localizator::getInstance().trajectory();
+            if (path_taken.empty()) return Points();
+            RotTransl Xt2_L = path_taken.lidar_pose(t2);
+
+            // Same window already deskewed (localization, then mapping offline), only deskew what's missing
+            bool reuse = this->cached(t2, Xt2_L);
+            if (reuse and this->cache.t1 <= t1) return this->take_cached(t1);
+            double new_t2 = reuse ? this->cache.t1 : t2;
 
-            // (Integrated) States surrounding t1 and t2
-            States path_taken = this->path(t1, t2);
-            assert (path_taken.size() >= 2);
+            // Points from t1 to t2
+            PointsView points = accum.get_points(t1, new_t2);
+            Points compensated = points.empty() ? Points() : this->compensate(path_taken, Xt2_L, points);
+
+            if (reuse) {
+                // Cached points start at cache.t1 (included)
+                while (not compensated.empty() and compensated.back().time >= new_t2) compensated.pop_back();
+                Points cached_points = this->take_cached(new_t2);
+                compensated.insert(compensated.end(), cached_points.begin(), cached_points.end());
+                return compensated;
+            }
 
-            // Compensated points given a path
-            State Xt2 = this->get_t2(path_taken, t2);
+            // Only mapping offline deskews a full resolution window twice, don't pay for a copy otherwise
+            if (not Config.mapping_online and not Config.downsample_before_deskew) {
+                this->cache.valid = true;
+                this->cache.t1 = t1;
+                this->cache.t2 = t2;
+                this->cache.R = Xt2_L.R;
+                this->cache.t = Xt2_L.t;
+                this->cache.points = compensated;
+            }
 
-            return this->compensate(path_taken, Xt2, points);
+            return compensated;
         }
 
-        States Compensator::path(double t1, double t2) {
+        Points Compensator::compensate_downsampled(double t1, double t2) {
             // Call Accumulator
             Accumulator& accum = Accumulator::getInstance();
 
-            // Get states just before t1 to t2
-            States states = accum.get_states(t1, t2);
-            states.push_front(accum.get_prev_state(t1));
+            // IMU-rate states the Localizator propagated through
+            const Trajectory& path_taken = Localizator::getInstance().trajectory();
+            if (path_taken.empty()) return Points();
+            RotTransl Xt2_L = path_taken.lidar_pose(t2);
 
-            // Get imus from first state to just after t2
-            IMUs imus = accum.get_imus(states.front().time, t2);
-            imus.push_back(accum.get_next_imu(t2));
+            // Representative points from t1 to t2 (with their own time)
+            Points ds_points = this->sensor_downsample(accum.get_points(t1, t2));
+            if (ds_points.empty()) return Points();
 
-            return this->upsample(states, imus);
+            return this->compensate(path_taken, Xt2_L, PointsView(ds_points));
         }
 
     // private:
         
-        State Compensator::get_t2(const States& states, double t2) {            
-            int s = states.size() - 1;
-            assert (states.front().time <= t2);
-            while (t2 < states[s].time) --s;
-            
-            State Xt2 = states[s];
-            Xt2 += IMU (Xt2.a, Xt2.w, t2);
-            return Xt2;
+        Points Compensator::downsample(const Points& points) {
+            return this->voxelgrid_downsample(points);
+            // return this->onion_downsample(points);
         }
 
         /*
             @Input:
-                states: before t1 and to t2
-                imus: before t1 and after t2
-            
+                path: path the car has taken
+                Xt2_L: LiDAR pose at t2, i.e. Xt2 * I_Rt_L
+                points: stamped points during path
             @Output:
-                upsampled_states (size := imus.size): before t1 and after t2
+                compensated_points: compensated points ready to be transported by Xt2_L
+            
+            @Pseudocode:
+                for each sample:
+                    for each point between sample and next_sample:
+                        compensate point matching its time via the sample's constant rates
         */
-        States Compensator::upsample(const States& states, const IMUs& imus) {
-            assert (imus.front().time <= states.front().time and states.back().time <= imus.back().time);
 
-            int s, u;
-            s = u = 0;
+        Points Compensator::compensate(const Trajectory& path, const RotTransl& Xt2_L, const PointsView& points) {
+            const std::vector<Trajectory::Sample>& samples = path.samples;
+            int Nsamples = samples.size();
+            assert (Nsamples > 0);
+
+            // Transport to X_t2^-1 frame
+            RotTransl Xt2_L_inv = RotTransl(Xt2_L).inv();
 
-            States upsampled_states;
-            State int_state = states[s];
+            Points t2_inv_ps;
+            t2_inv_ps.reserve(points.size());
+            for (const Point& p : points) t2_inv_ps.push_back(p);
 
-            // IMUs between two states
-            while (s < states.size() - 1) {
-                upsampled_states.push_back(states[s]);
+            // Points between each sample and the next one: [first, last)
+            std::vector<int> samples_used, firsts;
+            int p = 0;
+            int Npoints = t2_inv_ps.size();
 
-                while (u < imus.size() and imus[u].time < states[s+1].time) {
-                    int_state += imus[u++];
-                    upsampled_states.push_back(int_state);
-                }
+            // Points outside the path are extrapolated from its first/last sample
+            for (int s = path.index(points.front().time); s < Nsamples and p < Npoints; ++s) {
+                int first = p;
+                while (p < Npoints and (s == Nsamples - 1 or t2_inv_ps[p].time <= samples[s+1].time)) ++p;
+                if (p == first) continue;
 
-                int_state = states[s++];
+                samples_used.push_back(s);
+                firsts.push_back(first);
             }
+            firsts.push_back(Npoints);
 
-            if (u >= imus.size()) u = imus.size() - 1;
-            upsampled_states.push_back(states.back());
-            int_state = states.back();
+            // Compensate each interval at once with its sample's rates, intervals concurrently
+            ThreadPool& pool = ThreadPool::getInstance();
+            if (this->batches.size() < pool.size()) this->batches.resize(pool.size());
 
-            // IMUs after last state
-            while (int_state.time < imus.back().time and u < imus.size()) {
-                int_state += imus[u++];
-                upsampled_states.push_back(int_state);
-            }
+            pool.parallel_for(samples_used.size(), 4, [&](int first, int last, int thread) {
+                for (int i = first; i < last; ++i) {
+                    int N = firsts[i+1] - firsts[i];
+                    this->deskew(this->deskew_interval(samples[samples_used[i]], Xt2_L_inv), &t2_inv_ps[firsts[i]], N, this->batches[thread]);
+                }
+            });
 
-            return upsampled_states;
+            return t2_inv_ps;
         }
 
-        Points Compensator::downsample(const Points& points) {
-            return this->voxelgrid_downsample(points);
-            // return this->onion_downsample(points);
+        bool Compensator::cached(double t2, const RotTransl& Xt2_L) const {
+            return this->cache.valid and this->cache.t2 == t2 and this->cache.R == Xt2_L.R and this->cache.t == Xt2_L.t;
         }
 
-        /*
-            @Input:
-                states: path the car has taken (pre and post included)
-                points: stamped points during path
-            @Output:
-                compensated_points: compensated points ready to be transported by Xt2
-            
-            @Pseudocode:
-                for each state:
-                    for each point between state and next_state:
-                        compensate point matching its time via integrating state's last IMU
-        */
-
-        Points Compensator::compensate(const States& states, const State& Xt2, const Points& points) {
-            // States have to surround points
-            assert (not states.empty() and states.front().time <= points.front().time and  points.back().time <= states.back().time);
+        Points Compensator::take_cached(double t1) {
+            // Cached points are sorted by time
+            auto first = std::lower_bound(
+                this->cache.points.begin(), this->cache.points.end(), t1,
+                [](const Point& p, double t) { return p.time < t; }
+            );
+
+            // A window is reused at most once, so its points are moved out instead of copied
+            this->cache.points.erase(this->cache.points.begin(), first);
+            this->cache.valid = false;
+            return std::move(this->cache.points);
+        }
 
-            Points t2_inv_ps;
-            int p = 0;
+        Compensator::DeskewInterval Compensator::deskew_interval(const Trajectory::Sample& sample, const RotTransl& Xt2_L_inv) {
+            const Eigen::Matrix3f& M = Xt2_L_inv.R;
+
+            DeskewInterval interval;
+            interval.time = sample.time;
+            interval.A = M * sample.R;
+            interval.axis = sample.axis;
+            interval.ang_vel = sample.ang_vel;
+            interval.c0 = M*sample.pos + Xt2_L_inv.t;
+            interval.c1 = M*sample.vel;
+            interval.c2 = 0.5*M*sample.acc;
+            interval.RLI = sample.RLI;
+            interval.tLI = sample.tLI;
+
+            return interval;
+        }
 
-            for (int s = 0; s < states.size() - 1; ++s) {
-                while (p < points.size() and states[s].time <= points[p].time and points[p].time <= states[s+1].time) {                    
-                    // Integrate to point time
-                    State Xtp = states[s];
-                    Xtp += IMU (states[s].a, states[s].w, points[p].time);
+        void Compensator::deskew(const DeskewInterval& I, Point* points, int N, DeskewBatch& batch) {
+            if (batch.X.size() < N) {
+                for (Eigen::ArrayXf* array : {&batch.X, &batch.Y, &batch.Z, &batch.DT, &batch.UX, &batch.UY, &batch.UZ, &batch.SIN, &batch.COS})
+                    array->resize(N);
+            }
 
-                    // Transport to X_t2^-1 frame
-                    Point global_p = Xtp * Xtp.I_Rt_L() * points[p];
-                    Point t2_inv_p = Xt2.I_Rt_L().inv() * Xt2.inv() * global_p;
-                    t2_inv_ps.push_back(t2_inv_p);
+            auto x = batch.X.head(N), y = batch.Y.head(N), z = batch.Z.head(N), dt = batch.DT.head(N);
+            auto ux = batch.UX.head(N), uy = batch.UY.head(N), uz = batch.UZ.head(N);
+            auto sin = batch.SIN.head(N), cos = batch.COS.head(N);
 
-                    ++p;
-                }
+            // Gather
+            for (int i = 0; i < N; ++i) {
+                x[i] = points[i].x;
+                y[i] = points[i].y;
+                z[i] = points[i].z;
+                dt[i] = points[i].time - I.time;
             }
 
-            return t2_inv_ps;
+            // To IMU frame: u = RLI*p + tLI
+            const Eigen::Matrix3f& RLI = I.RLI;
+            ux = RLI(0,0)*x + RLI(0,1)*y + RLI(0,2)*z + I.tLI(0);
+            uy = RLI(1,0)*x + RLI(1,1)*y + RLI(1,2)*z + I.tLI(1);
+            uz = RLI(2,0)*x + RLI(2,1)*y + RLI(2,2)*z + I.tLI(2);
+
+            // Rotate during dt (Rodrigues): u + sin*(k x u) + (1 - cos)*(k x (k x u))
+            const Eigen::Vector3f& k = I.axis;
+            sin = (I.ang_vel*dt).sin();
+            cos = 1.f - (I.ang_vel*dt).cos();
+
+            x = k(1)*uz - k(2)*uy;
+            y = k(2)*ux - k(0)*uz;
+            z = k(0)*uy - k(1)*ux;
+            ux += sin*x + cos*(k(1)*z - k(2)*y);
+            uy += sin*y + cos*(k(2)*x - k(0)*z);
+            uz += sin*z + cos*(k(0)*y - k(1)*x);
+
+            // Then to X_t2^-1 frame
+            const Eigen::Matrix3f& A = I.A;
+            x = A(0,0)*ux + A(0,1)*uy + A(0,2)*uz + I.c0(0) + (I.c1(0) + I.c2(0)*dt)*dt;
+            y = A(1,0)*ux + A(1,1)*uy + A(1,2)*uz + I.c0(1) + (I.c1(1) + I.c2(1)*dt)*dt;
+            z = A(2,0)*ux + A(2,1)*uy + A(2,2)*uz + I.c0(2) + (I.c1(2) + I.c2(2)*dt)*dt;
+
+            // Scatter
+            for (int i = 0; i < N; ++i) {
+                points[i].x = x[i];
+                points[i].y = y[i];
+                points[i].z = z[i];
+            }
         }
 
         Points Compensator::voxelgrid_downsample(const Points& points) {
-            // Create a PointCloud pointer
-            pcl::PointCloud<full_info::Point>::Ptr pcl_ptr(new pcl::PointCloud<full_info::Point>());
-            Processor::fill(*pcl_ptr, points);
-
-            // Downsample using a VoxelGrid
-            pcl::PointCloud<full_info::Point> ds_pcl;
-            pcl::VoxelGrid<full_info::Point> filter;
-            filter.setInputCloud(pcl_ptr);
-            filter.setLeafSize(Config.downsample_prec, Config.downsample_prec, Config.downsample_prec);
-            filter.filter(ds_pcl);
-            
-            Points ds_points;
-            for (auto p : ds_pcl.points) ds_points.push_back(Point (p));
-            return ds_points;
+            VoxelDownsampler::Mode mode = Config.downsample_mode == "first" ? VoxelDownsampler::First : VoxelDownsampler::Centroid;
+            return this->voxel_filter.filter(PointsView(points), Config.downsample_prec, mode, Config.downsample_threads);
+        }
+
+        Points Compensator::sensor_downsample(const PointsView& points) {
+            // First point (in time) of each voxel, single-threaded so the output is still sorted by time
+            return this->voxel_filter.filter(points, Config.downsample_prec, VoxelDownsampler::First);
         }
 
         Points Compensator::onion_downsample(const Points& points) {
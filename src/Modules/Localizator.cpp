@@ -26,74 +26,89 @@ extern struct Params Config;
             this->last_time_updated = time;
         }
 
+        /*
+            The filter only uses H and h through H^T*H and H^T*h (its noise R is a scalar), so instead of
+            the N x 12 Jacobian, it is given a 12 x 12 one with the same normal equations:
+                H^T*H = V*L*V^T   =>   H' = L^(1/2)*V^T,   h' = L^(-1/2)*V^T*H^T*h
+        */
         void Localizator::calculate_H(const state_ikfom& s, const Matches& matches, Eigen::MatrixXd& H, Eigen::VectorXd& h) {
-            int Nmatches = matches.size();
-            H = Eigen::MatrixXd::Zero(Nmatches, 12);
-            h.resize(Nmatches);
-            State S(s, 0.);
-
-            // For each match, calculate its derivative and distance
-            for (int i = 0; i < matches.size(); ++i) {
-                Match match = matches[i];
-                Point p_lidar = S.I_Rt_L().inv() * S.inv() * match.point;
-                Point p_imu = S.I_Rt_L() * p_lidar;
-                Normal n = match.plane.n;
-
-                // Rotation matrices
-                Eigen::Matrix3d R_inv = s.rot.conjugate().toRotationMatrix();
-                Eigen::Matrix3d I_R_L_inv = s.offset_R_L_I.conjugate().toRotationMatrix();
-
-                // Calculate H (:= dh/dx)
-                Eigen::Vector3d C = (R_inv * n);
-                Eigen::Vector3d B = (p_lidar).cross(I_R_L_inv * C);
-                Eigen::Vector3d A = (p_imu).cross(C);
-                
-                H.block<1, 6>(i,0) << n.A, n.B, n.C, A(0), A(1), A(2);
-                if (Config.estimate_extrinsics) H.block<1, 6>(i,6) << B(0), B(1), B(2), C(0), C(1), C(2);
-
-                // Measurement: distance to the closest plane
-                h(i) = -match.distance;
-            }
+            Eigen::Matrix<double, 12, 12> HTH;
+            Eigen::Matrix<double, 12, 1> HTh;
+            this->calculate_HTH(s, matches, HTH, HTh);
+
+            Eigen::SelfAdjointEigenSolver<Eigen::Matrix<double, 12, 12>> solver(HTH);
+            Eigen::Matrix<double, 12, 1> L = solver.eigenvalues().cwiseMax(0.);
+            const Eigen::Matrix<double, 12, 12>& V = solver.eigenvectors();
+
+            // Directions without information (e.g. extrinsics if not estimated) stay at 0
+            Eigen::Matrix<double, 12, 1> L_sqrt = L.cwiseSqrt();
+            Eigen::Matrix<double, 12, 1> L_inv_sqrt;
+            for (int k = 0; k < 12; ++k) L_inv_sqrt(k) = L(k) > 1e-12*L.maxCoeff() ? 1./L_sqrt(k) : 0.;
+
+            H = L_sqrt.asDiagonal() * V.transpose();
+            h = L_inv_sqrt.asDiagonal() * (V.transpose() * HTh);
+        }
+
+        void Localizator::calculate_HTH(const state_ikfom& s, const Matches& matches, Eigen::Matrix<double, 12, 12>& HTH, Eigen::Matrix<double, 12, 1>& HTh) {
+            HTH.setZero();
+            HTh.setZero();
+
+            // Decided once per iteration instead of once per row
+            if (Config.estimate_extrinsics) this->accumulate_HTH<true>(s, matches, HTH, HTh);
+            else this->accumulate_HTH<false>(s, matches, HTH, HTh);
+
+            // Only the upper part was accumulated
+            HTH = HTH.selfadjointView<Eigen::Upper>();
         }
 
         void Localizator::propagate_to(double t) {
-            // Get new IMUs
-            IMUs imus = Accumulator::getInstance().get_imus(this->last_time_integrated, t);
+            // Get new IMUs (view valid until the next Accumulator::add)
+            IMUsView imus = Accumulator::getInstance().get_imus(this->last_time_integrated, t);
             if (this->last_time_integrated < 0) this->last_time_integrated = t;
 
             // Integrate every new IMU between last time and now
-            for (IMU imu : imus) {
+            for (const IMU& imu : imus) {
                 this->propagate(imu);
                 this->last_time_integrated = imu.time;
             }
             
             // Propagate last known IMU to t 
             if (not imus.empty()) {
-                this->propagate(IMU (imus.back().a, imus.back().w, t));
+                IMU last_imu(imus.back().a, imus.back().w, t);
+                this->propagate(last_imu);
                 this->last_time_integrated = t;
+
+                // State at t (replaced by the next one if corrected)
+                this->record(last_imu);
             }
         }
 
         State Localizator::latest_state() {
+            double time;
+
             // If no integrated, return empty state
-            if (this->last_time_integrated < 0)
-                return State (
-                    this->get_x(),
-                    Accumulator::getInstance().initial_time
-                );
-            
+            if (this->last_time_integrated < 0) time = Accumulator::getInstance().initial_time;
             // If no updates, return integrated state
-            if (this->last_time_updated < 0)
-                return State (
-                    this->get_x(),
-                    this->last_time_integrated
-                );
-            
+            else if (this->last_time_updated < 0) time = this->last_time_integrated;
             // Otherwise, return corrected state
-            return State (
-                this->get_x(),
-                this->last_time_updated
-            );
+            else time = this->last_time_updated;
+
+            State X(this->get_x(), time);
+
+            // Last controls
+            IMU imu = Accumulator::getInstance().get_next_imu(time);
+            X.a = imu.a;
+            X.w = imu.w;
+
+            return X;
+        }
+
+        const Trajectory& Localizator::trajectory() const {
+            return this->path_taken;
+        }
+
+        void Localizator::clear_trajectory(double t) {
+            this->path_taken.clear(t);
         }
 
     // private:
@@ -118,8 +133,8 @@ extern struct Params Config;
 
         void Localizator::initialize(double t) {
             // Get IMU at t
-            IMUs imus = Accumulator::getInstance().get_imus(-1, t);
-            IMU initial_IMU = imus.back();
+            IMUsView imus = Accumulator::getInstance().get_imus(-1, t);
+            const IMU& initial_IMU = imus.back();
 
             // Initialize state
             this->init_IKFoM_state(initial_IMU);
@@ -128,7 +143,8 @@ extern struct Params Config;
 
         void Localizator::IKFoM_update(const Points& points) {
             double solve_H_time = 0;
-            this->points2match = points;            
+            this->points2match = points;
+            Mapper::getInstance().forget_matches();
             this->IKFoM_KF.update_iterated_dyn_share_modified(Config.LiDAR_noise, Config.degeneracy_threshold, solve_H_time, Config.print_degeneracy_values);
         }
 
@@ -156,7 +172,92 @@ extern struct Params Config;
             return this->IKFoM_KF.get_x();
         }
 
+        /*
+            Rows of H, one match per column of a fixed-size block so each batch is added with a single product:
+                p_imu = R^-1*(p - pos),   p_lidar = I_R_L^-1*(p_imu - I_t_L)
+                row = [n, p_imu x C, p_lidar x (I_R_L^-1*C), C],   C = R^-1*n
+            Without extrinsics, the last 6 columns are always 0, so only the 6 x 6 block is accumulated.
+        */
+        template <bool EstimateExtrinsics>
+        void Localizator::accumulate_HTH(const state_ikfom& s, const Matches& matches, Eigen::Matrix<double, 12, 12>& HTH, Eigen::Matrix<double, 12, 1>& HTh) {
+            constexpr int ROWS = EstimateExtrinsics ? 12 : 6;
+            constexpr int BATCH = 64;
+            int Nmatches = matches.size();
+            int Nbatches = (Nmatches + BATCH - 1) / BATCH;
+
+            // Invariants of this iteration
+            const Eigen::Matrix3d R_inv = s.rot.conjugate().toRotationMatrix();
+            const Eigen::Matrix3d I_R_L_inv = s.offset_R_L_I.conjugate().toRotationMatrix();
+            const Eigen::Vector3d pos = s.pos;
+            const Eigen::Vector3d I_t_L = s.offset_T_L_I;
+
+            // Each batch has its own partial sums, reduced in order so the result doesn't depend on the threads
+            typedef Eigen::Matrix<double, ROWS, ROWS> BlockHTH;
+            typedef Eigen::Matrix<double, ROWS, 1> BlockHTh;
+            std::vector<BlockHTH, Eigen::aligned_allocator<BlockHTH>> partial_HTH(Nbatches);
+            std::vector<BlockHTh, Eigen::aligned_allocator<BlockHTh>> partial_HTh(Nbatches);
+
+            ThreadPool::getInstance().parallel_for(Nbatches, 1, [&](int first_batch, int last_batch, int thread) {
+                // Structure of arrays: one match per column
+                Eigen::Matrix<double, 3, BATCH> P, N, C, A, B;
+                Eigen::Matrix<double, 1, BATCH> h;
+                Eigen::Matrix<double, 12, BATCH> J;
+
+                for (int b = first_batch; b < last_batch; ++b) {
+                    int first = b*BATCH;
+                    int size = std::min(BATCH, Nmatches - first);
+
+                    // Gather (unused columns are 0 so they add nothing)
+                    P.setZero(); N.setZero(); h.setZero();
+                    for (int k = 0; k < size; ++k) {
+                        const Match& match = matches[first + k];
+                        P.col(k) << match.point.x, match.point.y, match.point.z;
+                        N.col(k) << match.plane.n.A, match.plane.n.B, match.plane.n.C;
+                        // Measurement: distance to the closest plane
+                        h(k) = -match.distance;
+                    }
+
+                    // p_imu (in P) and C
+                    P = R_inv * (P.colwise() - pos);
+                    C.noalias() = R_inv * N;
+                    this->cross(P, C, A);
+
+                    J.template topRows<3>() = N;
+                    J.template middleRows<3>(3) = A;
+
+                    if (EstimateExtrinsics) {
+                        // p_lidar (in P) and I_R_L^-1*C (in N)
+                        P = I_R_L_inv * (P.colwise() - I_t_L);
+                        N.noalias() = I_R_L_inv * C;
+                        this->cross(P, N, B);
+
+                        J.template middleRows<3>(6) = B;
+                        J.template middleRows<3>(9) = C;
+                    }
+
+                    partial_HTH[b].setZero();
+                    partial_HTH[b].template selfadjointView<Eigen::Upper>().rankUpdate(J.template topRows<ROWS>());
+                    partial_HTh[b].noalias() = J.template topRows<ROWS>() * h.transpose();
+                }
+            });
+
+            for (int b = 0; b < Nbatches; ++b) {
+                HTH.template topLeftCorner<ROWS, ROWS>() += partial_HTH[b];
+                HTh.template head<ROWS>() += partial_HTh[b];
+            }
+        }
+
+        template <int Cols>
+        void Localizator::cross(const Eigen::Matrix<double, 3, Cols>& U, const Eigen::Matrix<double, 3, Cols>& V, Eigen::Matrix<double, 3, Cols>& UxV) {
+            UxV.row(0) = U.row(1).cwiseProduct(V.row(2)) - U.row(2).cwiseProduct(V.row(1));
+            UxV.row(1) = U.row(2).cwiseProduct(V.row(0)) - U.row(0).cwiseProduct(V.row(2));
+            UxV.row(2) = U.row(0).cwiseProduct(V.row(1)) - U.row(1).cwiseProduct(V.row(0));
+        }
+
         void Localizator::propagate(const IMU& imu) {
+            // State before integrating, with the controls applied from now to imu.time
+            this->record(imu);
+
             input_ikfom in;
             in.acc = imu.a.cast<double>();
             in.gyro = imu.w.cast<double>();
@@ -172,6 +273,13 @@ extern struct Params Config;
             this->IKFoM_KF.predict(dt, Q, in);
         }
 
+        void Localizator::record(const IMU& imu) {
+            State X(this->get_x(), this->last_time_integrated);
+            X.a = imu.a;
+            X.w = imu.w;
+            this->path_taken.push(X);
+        }
+
         void Localizator::set_orientation(const IMU& imu) {
             state_ikfom current_state = this->IKFoM_KF.get_x();
             current_state.rot = imu.q.cast<double>();
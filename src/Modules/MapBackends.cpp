@@ -0,0 +1,151 @@
+#ifndef __OBJECTS_H__
+#define __OBJECTS_H__
+#include "Headers/Common.hpp"
+#include "Headers/Utils.hpp"
+#include "Headers/Objects.hpp"
+#include "Headers/Publishers.hpp"
+#include "Headers/PointClouds.hpp"
+#include "Headers/Accumulator.hpp"
+#include "Headers/Compensator.hpp"
+#include "Headers/Localizator.hpp"
+#include "Headers/Mapper.hpp"
+#endif
+
+extern struct Params Config;
+
+// class IkdTreeMap
+    // public:
+        IkdTreeMap::IkdTreeMap(float delete_param, float balance_param, float box_length) {
+            this->tree = KD_TREE<Point>::Ptr (new KD_TREE<Point>(delete_param, balance_param, box_length));
+        }
+
+        void IkdTreeMap::add(const Points& points, bool downsample) {
+            PointVector as_vector(points.begin(), points.end());
+
+            // If map doesn't exist, build it.
+            if (this->tree->size() == 0) this->tree->Build(as_vector);
+            else this->tree->Add_Points(as_vector, downsample);
+        }
+
+        int IkdTreeMap::size() {
+            return this->tree->size();
+        }
+
+        int IkdTreeMap::reserved() {
+            // Deleted points stay in the tree until their subtree is rebuilt
+            return this->tree->size();
+        }
+
+        void IkdTreeMap::knn(const Point& p, int k, PointVector& near_points, std::vector<float>& sq_dists) {
+            this->tree->Nearest_Search(p, k, near_points, sq_dists);
+        }
+
+// class IVoxMap
+    // public:
+        IVoxMap::IVoxMap(float voxel_size, int neighbours, int capacity, float min_dist)
+            : inv_voxel_size(1.f/voxel_size), capacity(capacity), min_sq_dist(min_dist*min_dist)
+        {
+            if (neighbours != 7 and neighbours != 27) {
+                ROS_WARN("iVox searches 7 or 27 neighbouring voxels, not %d. Using 7.", neighbours);
+                neighbours = 7;
+            }
+
+            // Own voxel first
+            this->offsets.push_back(Eigen::Vector3i::Zero());
+
+            for (int i = -1; i <= 1; ++i) {
+                for (int j = -1; j <= 1; ++j) {
+                    for (int k = -1; k <= 1; ++k) {
+                        int shared = std::abs(i) + std::abs(j) + std::abs(k);
+                        if (shared == 0) continue;
+                        if (neighbours == 7 and shared > 1) continue;
+                        this->offsets.push_back(Eigen::Vector3i(i, j, k));
+                    }
+                }
+            }
+        }
+
+        void IVoxMap::add(const Points& points, bool downsample) {
+            for (const Point& p : points) {
+                Eigen::Vector3i c = this->coords(p);
+                std::uint64_t key = VoxelDownsampler::key(c(0), c(1), c(2));
+
+                auto it = this->index.find(key);
+                if (it == this->index.end()) {
+                    it = this->index.emplace(key, this->voxels.size()).first;
+                    this->voxels.emplace_back();
+                    this->voxels.back().reserve(this->capacity);
+                }
+
+                // Full voxels don't grow
+                PointVector& voxel = this->voxels[it->second];
+                if (voxel.size() >= this->capacity) continue;
+
+                if (downsample) {
+                    bool close = false;
+                    for (const Point& q : voxel) {
+                        float dx = p.x - q.x, dy = p.y - q.y, dz = p.z - q.z;
+                        if (dx*dx + dy*dy + dz*dz < this->min_sq_dist) {
+                            close = true;
+                            break;
+                        }
+                    }
+                    if (close) continue;
+                }
+
+                voxel.push_back(p);
+                ++this->Npoints;
+            }
+        }
+
+        int IVoxMap::size() {
+            return this->Npoints;
+        }
+
+        int IVoxMap::reserved() {
+            // Every voxel reserves room for all its points
+            return this->voxels.size() * this->capacity;
+        }
+
+        void IVoxMap::knn(const Point& p, int k, PointVector& near_points, std::vector<float>& sq_dists) {
+            // k best candidates, kept sorted by insertion
+            std::vector<std::pair<float, const Point*>> best;
+            std::size_t Nbest = k;
+            best.reserve(Nbest + 1);
+
+            Eigen::Vector3i c = this->coords(p);
+            for (const Eigen::Vector3i& offset : this->offsets) {
+                Eigen::Vector3i n = c + offset;
+                auto it = this->index.find(VoxelDownsampler::key(n(0), n(1), n(2)));
+                if (it == this->index.end()) continue;
+
+                for (const Point& q : this->voxels[it->second]) {
+                    float dx = p.x - q.x, dy = p.y - q.y, dz = p.z - q.z;
+                    float d = dx*dx + dy*dy + dz*dz;
+                    if (best.size() == Nbest and d >= best.back().first) continue;
+
+                    auto pos = std::upper_bound(
+                        best.begin(), best.end(), d,
+                        [](float d, const std::pair<float, const Point*>& b) { return d < b.first; }
+                    );
+                    best.insert(pos, std::make_pair(d, &q));
+                    if (best.size() > Nbest) best.pop_back();
+                }
+            }
+
+            near_points.clear();
+            sq_dists.clear();
+            for (const auto& b : best) {
+                near_points.push_back(*b.second);
+                sq_dists.push_back(b.first);
+            }
+        }
+
+    // private:
+        Eigen::Vector3i IVoxMap::coords(const Point& p) const {
+            return Eigen::Vector3i(
+                std::floor(p.x * this->inv_voxel_size),
+                std::floor(p.y * this->inv_voxel_size),
+                std::floor(p.z * this->inv_voxel_size)
+            );
+        }
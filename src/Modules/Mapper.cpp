@@ -15,16 +15,27 @@ extern struct Params Config;
 
 // class Mapper
     // public:
-        Mapper::Mapper() {  // TODO: (const KDTREE_OPTIONS& options) {
-            this->init_tree();
+        Mapper::Mapper() {
+            this->init_map();
         }
 
         void Mapper::add(Points& points, double time, bool downsample) {
             if (points.empty()) return;
 
-            // If map doesn't exist, build it.
-            if (not this->exists()) this->build_tree(points);
-            else this->add_points(points, downsample);
+            auto begin = std::chrono::steady_clock::now();
+            this->map->add(points, downsample);
+            auto end = std::chrono::steady_clock::now();
+
+            Metrics& metrics = Metrics::getInstance();
+            metrics.add("Mapping - Add (us)", std::chrono::duration<double, std::micro>(end - begin).count());
+            metrics.add("Mapping - Map points", this->map->size());
+            metrics.add("Mapping - Map reserved points", this->map->reserved());
+
+            // Refit the map's planes where it changed
+            if (Config.map_planes_prec > 0) this->add_to_voxels(points);
+
+            // Neighbours of the planes around the new points may have changed
+            if (Config.match_cache_prec > 0 and not this->recent_support.empty()) this->forget_planes(points);
 
             this->last_map_time = time;
         }
@@ -34,57 +45,277 @@ extern struct Params Config;
         }
 
         bool Mapper::exists() {
-            return this->exists_tree();
+            return this->map->size() > 0;
         }
 
         Matches Mapper::match(const State& X, const Points& points) {            
             Matches matches;
             if (not this->exists()) return matches;
             matches.reserve(points.size());
-            
-            omp_set_num_threads(MP_PROC_NUM);
-            #pragma omp parallel for
-            for (int pi = 0; pi < points.size(); ++pi) {
-                Point p = points[pi];
-
-                // Direct approach: we match the point with a plane on the map
-                Match match = this->match_plane(X * X.I_Rt_L() * p);
-                if (match.is_chosen()) matches.push_back(match);
+
+            // Same points as the previous call (next IEKF iteration) unless forgotten
+            if (this->cached_matches.size() != points.size()) this->cached_matches.assign(points.size(), CachedMatch());
+            RotTransl X_L = X * X.I_Rt_L();
+            float reuse_sq_dist = Config.match_reuse_dist*Config.match_reuse_dist;
+            bool use_recent = Config.match_cache_prec > 0;
+            float inv_cache_prec = use_recent ? 1.f/Config.match_cache_prec : 0.f;
+            bool use_voxels = Config.map_planes_prec > 0;
+            float inv_voxels_prec = use_voxels ? 1.f/Config.map_planes_prec : 0.f;
+            int Npoints = points.size();
+
+            // Counted per thread, each thread only runs one chunk at a time
+            ThreadPool& pool = ThreadPool::getInstance();
+            std::vector<int> reused(pool.size(), 0), from_voxels(pool.size(), 0), recalled(pool.size(), 0);
+            std::vector<double> busy(pool.size(), 0.);
+            if (this->fitters.size() < pool.size()) this->fitters.resize(pool.size());
+
+            // Each point only writes its own slot, so the result doesn't depend on the threads
+            pool.parallel_for(Npoints, 64, [&](int first, int last, int thread) {
+                auto begin = std::chrono::steady_clock::now();
+
+                // Neighbours searched in this chunk, their planes are fitted all at once
+                PlaneFitter& fitter = this->fitters[thread];
+                fitter.reset(Config.NUM_MATCH_POINTS);
+                std::vector<int> searched;
+                PointVector near_points;
+                std::vector<float> sq_dists;
+
+                for (int pi = first; pi < last; ++pi) {
+                    Point p = X_L * points[pi];
+                    CachedMatch& cached = this->cached_matches[pi];
+                    cached.point = p;
+
+                    // Only search again if it moved enough or it had no plane
+                    if (cached.searched and cached.plane.is_plane and (p.toEigen() - cached.query.toEigen()).squaredNorm() <= reuse_sq_dist) {
+                        cached.source = CachedMatch::Reused;
+                        ++reused[thread];
+                        continue;
+                    }
+
+                    // The map is flat enough in its voxel (only read, refitted when mapping)
+                    auto voxel = use_voxels ? this->map_planes.find(VoxelDownsampler::key(p, inv_voxels_prec)) : this->map_planes.end();
+                    if (voxel != this->map_planes.end() and voxel->second.plane.is_plane) {
+                        cached.plane = voxel->second.plane;
+                        cached.source = CachedMatch::Voxel;
+                        cached.query = p;
+                        cached.searched = true;
+                        ++from_voxels[thread];
+                        continue;
+                    }
+
+                    // A previous window already found a plane there (only read, new ones are added after the loop)
+                    auto recent = use_recent ? this->recent_planes.find(VoxelDownsampler::key(p, inv_cache_prec)) : this->recent_planes.end();
+                    if (recent != this->recent_planes.end() and this->is_recent(recent->second)) {
+                        cached.plane = recent->second.plane;
+                        cached.source = CachedMatch::Recent;
+                        ++recalled[thread];
+                    }
+                    else {
+                        // Direct approach: we match the point with a plane on the map
+                        this->map->knn(p, Config.NUM_MATCH_POINTS, near_points, sq_dists);
+                        fitter.add(near_points, sq_dists);
+                        searched.push_back(pi);
+                        cached.source = CachedMatch::Searched;
+                        cached.reach = sq_dists.empty() ? 0.f : std::sqrt(sq_dists.back());
+                    }
+
+                    cached.query = p;
+                    cached.searched = true;
+                }
+
+                const std::vector<Plane>& planes = fitter.fit(Config.PLANES_THRESHOLD);
+                for (int i = 0; i < searched.size(); ++i) this->cached_matches[searched[i]].plane = planes[i];
+
+                auto end = std::chrono::steady_clock::now();
+                busy[thread] += std::chrono::duration<double, std::micro>(end - begin).count();
+            });
+
+            Metrics& metrics = Metrics::getInstance();
+            for (int t = 0; t < pool.size(); ++t)
+                if (busy[t] > 0) metrics.add("Matching - Thread " + std::to_string(t) + " (us)", busy[t]);
+
+            // Compact the chosen ones in the order of the points
+            for (const CachedMatch& cached : this->cached_matches)
+                if (cached.plane.is_plane) matches.push_back(Match(cached.point, cached.plane));
+
+            if (use_recent) this->remember_planes();
+
+            if (Npoints > 0) {
+                int Nreused = std::accumulate(reused.begin(), reused.end(), 0);
+                int Nrecalled = std::accumulate(recalled.begin(), recalled.end(), 0);
+                int Nfrom_voxels = std::accumulate(from_voxels.begin(), from_voxels.end(), 0);
+                metrics.add("Matching - Reused planes (%)", 100.*Nreused/Npoints);
+                if (use_voxels) metrics.add("Matching - Map voxel planes (%)", 100.*Nfrom_voxels/Npoints);
+                if (use_recent) metrics.add("Matching - Recent planes hits (%)", 100.*Nrecalled/Npoints);
             }
 
             return matches;
         }
 
+        void Mapper::forget_matches() {
+            this->cached_matches.clear();
+
+            // New window, drop some of the planes that haven't been used for a while (lookups already skip them)
+            ++this->window;
+            if (Config.match_cache_prec > 0) this->sweep_recent_planes();
+        }
+
         bool Mapper::hasToMap(double t) {
             if (this->last_map_time < 0) this->last_map_time = t;
             return t - this->last_map_time >= Config.full_rotation_time;
         }
 
     // private:
-        void Mapper::init_tree() {  // TODO: (const KDTREE_OPTIONS& options) {
-            this->map = KD_TREE<Point>::Ptr (new KD_TREE<Point>(0.3, 0.6, 0.2));
+        void Mapper::init_map() {
+            if (Config.map_backend == "ivox") this->map.reset(new IVoxMap(Config.ivox_prec, Config.ivox_neighbours, Config.ivox_capacity, 0.2));
+            else {
+                if (Config.map_backend != "ikd-tree") ROS_WARN("Unknown map_backend '%s', using ikd-tree.", Config.map_backend.c_str());
+                this->map.reset(new IkdTreeMap(0.3, 0.6, 0.2));
+            }
         }
 
-        void Mapper::build_tree(Points& points) {
-            PointVector as_vector; for (Point p : points) as_vector.push_back(p);
-            this->map->Build(as_vector);
+        void Mapper::remember_planes() {
+            float inv_prec = 1.f/Config.match_cache_prec;
+
+            for (const CachedMatch& cached : this->cached_matches) {
+                if (cached.source == CachedMatch::Reused or cached.source == CachedMatch::Voxel) continue;
+                std::uint64_t key = VoxelDownsampler::key(cached.query, inv_prec);
+
+                auto recent = this->recent_planes.find(key);
+                bool known = recent != this->recent_planes.end() and this->is_recent(recent->second);
+
+                // Keep the first plane found in each voxel
+                if (cached.source == CachedMatch::Recent and known) recent->second.window = this->window;
+                else if (cached.source == CachedMatch::Searched and cached.plane.is_plane and not known) {
+                    Eigen::Vector3f query = cached.query.toEigen();
+                    Eigen::Vector3f reach = Eigen::Vector3f::Constant(cached.reach);
+                    RecentPlane& stored = this->recent_planes[key] = RecentPlane{cached.plane, this->window, query - reach, query + reach};
+                    this->add_support(key, stored);
+                }
+            }
         }
 
-        void Mapper::add_points(Points& points, bool downsample) {
-            PointVector as_vector; for (Point p : points) as_vector.push_back(p);
-            this->map->Add_Points(as_vector, downsample);
+        bool Mapper::is_recent(const RecentPlane& recent) const {
+            return this->window - recent.window <= RECENT_WINDOWS;
         }
 
-        bool Mapper::exists_tree() {
-            return this->map->size() > 0;
+        void Mapper::sweep_recent_planes() {
+            // A slice of the buckets per window, so every plane is checked once every RECENT_WINDOWS windows
+            std::vector<std::uint64_t> old;
+            std::size_t buckets = this->recent_planes.bucket_count();
+            for (std::size_t b = 0; b < buckets/RECENT_WINDOWS + 1; ++b) {
+                std::size_t bucket = this->swept_plane++ % buckets;
+                for (auto it = this->recent_planes.begin(bucket); it != this->recent_planes.end(bucket); ++it)
+                    if (not this->is_recent(it->second)) old.push_back(it->first);
+            }
+
+            for (std::uint64_t key : old) this->recent_planes.erase(key);
+
+            // Same for the support cells, forgetting the planes already erased
+            std::vector<std::uint64_t> empty;
+            buckets = this->recent_support.bucket_count();
+            for (std::size_t b = 0; b < buckets/RECENT_WINDOWS + 1; ++b) {
+                std::size_t bucket = this->swept_cell++ % buckets;
+                for (auto it = this->recent_support.begin(bucket); it != this->recent_support.end(bucket); ++it) {
+                    std::vector<std::uint64_t>& keys = it->second;
+                    keys.erase(std::remove_if(keys.begin(), keys.end(), [this](std::uint64_t key) { return this->recent_planes.count(key) == 0; }), keys.end());
+                    if (keys.empty()) empty.push_back(it->first);
+                }
+            }
+
+            for (std::uint64_t cell : empty) this->recent_support.erase(cell);
+        }
+
+        void Mapper::add_support(std::uint64_t key, const RecentPlane& recent) {
+            // Its reach is below MAX_DIST_PLANE, so it touches 8 cells at most
+            float inv_prec = 1.f/Config.MAX_DIST_PLANE;
+            Eigen::Vector3i first = (recent.support_min * inv_prec).array().floor().cast<int>().matrix();
+            Eigen::Vector3i last = (recent.support_max * inv_prec).array().floor().cast<int>().matrix();
+
+            for (int i = first.x(); i <= last.x(); ++i)
+                for (int j = first.y(); j <= last.y(); ++j)
+                    for (int k = first.z(); k <= last.z(); ++k) {
+                        std::vector<std::uint64_t>& keys = this->recent_support[VoxelDownsampler::key(i, j, k)];
+                        if (std::find(keys.begin(), keys.end(), key) == keys.end()) keys.push_back(key);
+                    }
         }
 
-        Match Mapper::match_plane(const Point& p) {
-            // Find k nearest points
-            PointVector near_points;
-            vector<float> pointSearchSqDis(Config.NUM_MATCH_POINTS);
-            this->map->Nearest_Search(p, Config.NUM_MATCH_POINTS, near_points, pointSearchSqDis);
+        void Mapper::forget_planes(const Points& points) {
+            float inv_prec = 1.f/Config.MAX_DIST_PLANE;
+
+            for (const Point& p : points) {
+                auto cell = this->recent_support.find(VoxelDownsampler::key(p, inv_prec));
+                if (cell == this->recent_support.end()) continue;
+
+                // Erase the planes whose support has the point (and forget the ones already erased)
+                std::vector<std::uint64_t>& keys = cell->second;
+                keys.erase(std::remove_if(keys.begin(), keys.end(), [&](std::uint64_t key) {
+                    auto recent = this->recent_planes.find(key);
+                    if (recent == this->recent_planes.end()) return true;
+
+                    Eigen::Vector3f x = p.toEigen();
+                    const RecentPlane& plane = recent->second;
+                    if ((x.array() < plane.support_min.array()).any() or (x.array() > plane.support_max.array()).any()) return false;
 
-            // Construct a plane fitting between them
-            return Match(p, Plane (near_points, pointSearchSqDis));
-        }
\ No newline at end of file
+                    this->recent_planes.erase(recent);
+                    return true;
+                }), keys.end());
+
+                if (keys.empty()) this->recent_support.erase(cell);
+            }
+        }
+
+        void Mapper::add_to_voxels(const Points& points) {
+            float inv_prec = 1.f/Config.map_planes_prec;
+            std::vector<MapVoxel*> changed;
+
+            // Accumulate the new points' moments
+            for (const Point& p : points) {
+                MapVoxel& voxel = this->map_planes[VoxelDownsampler::key(p, inv_prec)];
+                Eigen::Vector3d x = p.toEigen().cast<double>();
+                voxel.count++;
+                voxel.sum += x;
+                voxel.outer.noalias() += x * x.transpose();
+
+                if (not voxel.dirty) changed.push_back(&voxel);
+                voxel.dirty = true;
+            }
+
+            // Refit them (pointers are stable in an unordered_map)
+            for (MapVoxel* voxel : changed) this->fit_voxel(*voxel);
+        }
+
+        /*
+            Least squares plane from the moments of the voxel's points:
+                mean = sum/N,   cov = outer/N - mean*mean^T
+                normal = eigenvector of the smallest eigenvalue, which is the mean squared distance to the plane
+            Only a plane if its points are close enough to it and they are not on a line.
+            Note it bounds the RMS distance, while searched fits bound every point's (so it's a looser test, off by default).
+        */
+        void Mapper::fit_voxel(MapVoxel& voxel) {
+            voxel.dirty = false;
+            voxel.plane.is_plane = false;
+            if (voxel.count < Config.NUM_MATCH_POINTS) return;
+
+            Eigen::Vector3d mean = voxel.sum / voxel.count;
+            Eigen::Matrix3d cov = voxel.outer / voxel.count - mean * mean.transpose();
+
+            Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> solver;
+            solver.computeDirect(cov);
+            Eigen::Vector3d L = solver.eigenvalues().cwiseMax(0.);
+            voxel.rms = std::sqrt(L(0));
+
+            if (voxel.rms >= Config.PLANES_THRESHOLD) return;
+            if (L(1) < 9.*L(0)) return;
+
+            // Same sign as the fitted planes: positive D
+            Eigen::Vector3d n = solver.eigenvectors().col(0);
+            double D = -n.dot(mean);
+            if (D < 0) { n = -n; D = -D; }
+
+            Eigen::Matrix<float, 4, 1> ABCD;
+            ABCD << n.cast<float>(), D;
+            voxel.plane.n = Normal(ABCD);
+            voxel.plane.centroid = Point(Eigen::Vector3f(mean.cast<float>()));
+            voxel.plane.is_plane = true;
+        }
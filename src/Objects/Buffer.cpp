@@ -14,8 +14,6 @@
 extern struct Params Config;
 
 template class Buffer<IMU>;
-template class Buffer<Point>;
-template class Buffer<State>;
 
 // class Buffer {
     // public:
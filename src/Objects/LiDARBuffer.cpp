@@ -0,0 +1,149 @@
+#ifndef __OBJECTS_H__
+#define __OBJECTS_H__
+#include "Headers/Common.hpp"
+#include "Headers/Utils.hpp"
+#include "Headers/Objects.hpp"
+#include "Headers/Publishers.hpp"
+#include "Headers/PointClouds.hpp"
+#include "Headers/Accumulator.hpp"
+#include "Headers/Compensator.hpp"
+#include "Headers/Localizator.hpp"
+#include "Headers/Mapper.hpp"
+#endif
+
+extern struct Params Config;
+
+// class PointsBlock {
+    // public:
+        PointsBlock::PointsBlock(Points&& time_sorted_points) : points(std::move(time_sorted_points)) {
+            this->begin = this->points.front().time;
+            this->end = this->points.back().time;
+        }
+
+// class PointsView {
+    // public:
+        PointsView::PointsView(const Points& points) {
+            if (not points.empty()) this->spans.emplace_back(points.data(), points.data() + points.size());
+        }
+
+        PointsView::iterator PointsView::begin() const {
+            if (this->spans.empty()) return this->end();
+            return iterator(&this->spans, 0, this->spans.front().first);
+        }
+
+        PointsView::iterator PointsView::end() const {
+            if (this->spans.empty()) return iterator(&this->spans, 0, nullptr);
+            return iterator(&this->spans, this->spans.size() - 1, this->spans.back().second);
+        }
+
+        const Point& PointsView::front() const {
+            return *this->spans.front().first;
+        }
+
+        const Point& PointsView::back() const {
+            return *(this->spans.back().second - 1);
+        }
+
+        bool PointsView::empty() const {
+            return this->spans.empty();
+        }
+
+        int PointsView::size() const {
+            int n = 0;
+            for (const Span& span : this->spans) n += span.second - span.first;
+            return n;
+        }
+
+// class LiDARBuffer {
+    // public:
+        LiDARBuffer::LiDARBuffer() {}
+
+        void LiDARBuffer::push(Points&& time_sorted_points) {
+            if (time_sorted_points.empty()) return;
+            PointsBlock block(std::move(time_sorted_points));
+
+            // Messages usually arrive in order, so this is O(1)
+            auto it = this->blocks.end();
+            while (it != this->blocks.begin() and block.begin < std::prev(it)->begin) --it;
+            this->blocks.insert(it, std::move(block));
+        }
+
+        PointsView LiDARBuffer::get(TimeType t1, TimeType t2) const {
+            PointsView view;
+            TimeType latest = -std::numeric_limits<TimeType>::infinity();
+            bool sorted = true;
+
+            // Blocks can overlap, so ends aren't sorted: scan them all until t2 (clear() keeps them few)
+            for (const PointsBlock& block : this->blocks) {
+                if (block.begin > t2) break;
+                if (block.end < t1) continue;
+
+                // Get content between t1 from t2 (both included) sorted old to new
+                auto first = std::lower_bound(
+                    block.points.begin(), block.points.end(), t1,
+                    [](const Point& p, TimeType t) { return p.time < t; }
+                );
+
+                auto last = std::upper_bound(
+                    first, block.points.end(), t2,
+                    [](TimeType t, const Point& p) { return t < p.time; }
+                );
+
+                if (first == last) continue;
+
+                // Running max of the spans' ends tells if this one starts before a previous one finished
+                if (first->time < latest) sorted = false;
+                latest = std::max(latest, std::prev(last)->time);
+
+                view.spans.emplace_back(&*first, &*first + (last - first));
+            }
+
+            return sorted ? view : this->merge(view);
+        }
+
+        bool LiDARBuffer::empty() const {
+            return this->blocks.empty();
+        }
+
+        int LiDARBuffer::size() const {
+            int n = 0;
+            for (const PointsBlock& block : this->blocks) n += block.points.size();
+            return n;
+        }
+
+        void LiDARBuffer::clear() {
+            this->blocks.clear();
+        }
+
+        void LiDARBuffer::clear(TimeType t) {
+            // Only whole blocks are dropped, the rest of points are filtered out in get()
+            // Blocks can overlap, so any block that ended before t goes, not only the oldest ones
+            this->blocks.erase(
+                std::remove_if(
+                    this->blocks.begin(), this->blocks.end(),
+                    [t](const PointsBlock& b) { return t >= b.end; }
+                ),
+                this->blocks.end()
+            );
+        }
+
+    // private:
+        PointsView LiDARBuffer::merge(const PointsView& overlapping) const {
+            // Merge the spans one by one into a single time-sorted copy owned by the view
+            std::shared_ptr<Points> merged = std::make_shared<Points>();
+            merged->reserve(overlapping.size());
+
+            for (const PointsView::Span& span : overlapping.spans) {
+                int middle = merged->size();
+                merged->insert(merged->end(), span.first, span.second);
+                std::inplace_merge(
+                    merged->begin(), merged->begin() + middle, merged->end(),
+                    [](const Point& p1, const Point& p2) { return p1.time < p2.time; }
+                );
+            }
+
+            PointsView view;
+            view.spans.emplace_back(merged->data(), merged->data() + merged->size());
+            view.merged = merged;
+            return view;
+        }
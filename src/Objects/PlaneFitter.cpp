@@ -0,0 +1,177 @@
+#ifndef __OBJECTS_H__
+#define __OBJECTS_H__
+#include "Headers/Common.hpp"
+#include "Headers/Utils.hpp"
+#include "Headers/Objects.hpp"
+#include "Headers/Publishers.hpp"
+#include "Headers/PointClouds.hpp"
+#include "Headers/Accumulator.hpp"
+#include "Headers/Compensator.hpp"
+#include "Headers/Localizator.hpp"
+#include "Headers/Mapper.hpp"
+#endif
+
+extern struct Params Config;
+
+// class PlaneFitter
+    // public:
+        void PlaneFitter::reset(int k) {
+            this->k = k;
+            this->N = 0;
+            this->valid.clear();
+            if (this->X.rows() == k) return;
+
+            this->X.resize(k, 0);
+            this->Y.resize(k, 0);
+            this->Z.resize(k, 0);
+        }
+
+        void PlaneFitter::add(const PointVector& near_points, const std::vector<float>& sq_dists) {
+            // Grow the batch (kept between batches)
+            if (this->N == this->X.cols()) {
+                int capacity = std::max(64, 2*this->N);
+                this->X.conservativeResize(this->k, capacity);
+                this->Y.conservativeResize(this->k, capacity);
+                this->Z.conservativeResize(this->k, capacity);
+            }
+
+            // Enough neighbours and all of them close enough
+            bool enough_points = near_points.size() >= this->k;
+            bool close_enough = not sq_dists.empty() and sq_dists.back() < Config.MAX_DIST_PLANE*Config.MAX_DIST_PLANE;
+            this->valid.push_back(enough_points and close_enough);
+
+            for (int j = 0; j < this->k; ++j) {
+                this->X(j, this->N) = enough_points ? near_points[j].x : 0.;
+                this->Y(j, this->N) = enough_points ? near_points[j].y : 0.;
+                this->Z(j, this->N) = enough_points ? near_points[j].z : 0.;
+            }
+
+            ++this->N;
+        }
+
+        int PlaneFitter::size() const {
+            return this->N;
+        }
+
+        const std::vector<Plane>& PlaneFitter::fit(float threshold) {
+            this->planes.resize(this->N);
+            if (this->N == 0) return this->planes;
+
+            switch (this->k) {
+                case 3: this->fit_kernel<3>(threshold); break;
+                case 4: this->fit_kernel<4>(threshold); break;
+                case 5: this->fit_kernel<5>(threshold); break;
+                case 6: this->fit_kernel<6>(threshold); break;
+                case 7: this->fit_kernel<7>(threshold); break;
+                case 8: this->fit_kernel<8>(threshold); break;
+                default: this->fit_each(threshold);
+            }
+
+            return this->planes;
+        }
+
+    // private:
+        /*
+            Total least squares plane of each query's K neighbours, all queries at once:
+                centroid c, covariance C of the neighbours around it
+                normal n = eigenvector of C's smallest eigenvalue (closed form for symmetric 3x3, in double
+                    since float can't tell the normal of nearly collinear neighbours),
+                    taken as the largest cross product of two rows of (C - l3*I)
+                plane: n*p + D = 0, D = -n*c (with D > 0, like the single fits)
+            A plane only if every neighbour is within 'threshold' of it (residuals in the same pass).
+        */
+        template <int K>
+        void PlaneFitter::fit_kernel(float threshold) {
+            typedef Eigen::Array<double, K, Eigen::Dynamic> Neighbours;
+            typedef Eigen::Array<double, 1, Eigen::Dynamic> PerQuery;
+            int N = this->N;
+
+            Eigen::Map<const Neighbours> x(this->X.data(), K, N), y(this->Y.data(), K, N), z(this->Z.data(), K, N);
+
+            // Centroids
+            PerQuery cx = x.colwise().sum() / K;
+            PerQuery cy = y.colwise().sum() / K;
+            PerQuery cz = z.colwise().sum() / K;
+
+            // Covariances
+            Neighbours dx = x.rowwise() - cx;
+            Neighbours dy = y.rowwise() - cy;
+            Neighbours dz = z.rowwise() - cz;
+            PerQuery cxx = (dx*dx).colwise().sum() / K, cyy = (dy*dy).colwise().sum() / K, czz = (dz*dz).colwise().sum() / K;
+            PerQuery cxy = (dx*dy).colwise().sum() / K, cxz = (dx*dz).colwise().sum() / K, cyz = (dy*dz).colwise().sum() / K;
+
+            // Smallest eigenvalue: l3 = q + 2p*cos(acos(det(B)/2)/3 + 2pi/3), B = (C - q*I)/p
+            PerQuery q = (cxx + cyy + czz) / 3.;
+            PerQuery p = (((cxx - q).square() + (cyy - q).square() + (czz - q).square() + 2.*(cxy.square() + cxz.square() + cyz.square())) / 6.).sqrt();
+            PerQuery p_inv = (p > 1e-12).select(p.inverse(), 0.);
+
+            PerQuery b11 = (cxx - q)*p_inv, b22 = (cyy - q)*p_inv, b33 = (czz - q)*p_inv;
+            PerQuery b12 = cxy*p_inv, b13 = cxz*p_inv, b23 = cyz*p_inv;
+            PerQuery det_B = b11*(b22*b33 - b23*b23) - b12*(b12*b33 - b23*b13) + b13*(b12*b23 - b22*b13);
+            PerQuery phi = (0.5*det_B).max(-1.).min(1.).acos() / 3.;
+            PerQuery l3 = q + 2.*p*(phi + 2.*M_PI/3.).cos();
+
+            // Rows of C - l3*I, their cross products are parallel to the normal
+            PerQuery r00 = cxx - l3, r11 = cyy - l3, r22 = czz - l3;
+            PerQuery ax = cxy*cyz - cxz*r11, ay = cxz*cxy - r00*cyz, az = r00*r11 - cxy*cxy;     // row0 x row1
+            PerQuery bx = cxy*r22 - cxz*cyz, by = cxz*cxz - r00*r22, bz = r00*cyz - cxy*cxz;     // row0 x row2
+            PerQuery ex = r11*r22 - cyz*cyz, ey = cyz*cxz - cxy*r22, ez = cxy*cyz - r11*cxz;     // row1 x row2
+            PerQuery na = ax.square() + ay.square() + az.square();
+            PerQuery nb = bx.square() + by.square() + bz.square();
+            PerQuery ne = ex.square() + ey.square() + ez.square();
+
+            PerQuery a_best = (na >= nb and na >= ne).template cast<double>();
+            PerQuery b_best = (1. - a_best) * (nb >= ne).template cast<double>();
+            PerQuery e_best = 1. - a_best - b_best;
+            PerQuery nx = a_best*ax + b_best*bx + e_best*ex;
+            PerQuery ny = a_best*ay + b_best*by + e_best*ey;
+            PerQuery nz = a_best*az + b_best*bz + e_best*ez;
+            PerQuery n_norm2 = a_best*na + b_best*nb + e_best*ne;
+
+            // Collinear (or repeated) neighbours have no plane
+            PerQuery trace = 3.*q;
+            PerQuery defined = (n_norm2 > 1e-10*trace.square().square() and n_norm2 > 0.).template cast<double>();
+            PerQuery n_inv = defined * (n_norm2 > 0.).select(n_norm2.rsqrt(), 0.);
+            nx *= n_inv;
+            ny *= n_inv;
+            nz *= n_inv;
+
+            PerQuery D = -(nx*cx + ny*cy + nz*cz);
+            PerQuery sign = (D < 0.).select(PerQuery::Constant(N, -1.), PerQuery::Constant(N, 1.));
+            nx *= sign;
+            ny *= sign;
+            nz *= sign;
+            D *= sign;
+
+            // Every neighbour close to its plane
+            Neighbours residuals = ((x.rowwise()*nx + y.rowwise()*ny + z.rowwise()*nz).rowwise() + D).abs();
+            PerQuery max_residual = residuals.colwise().maxCoeff();
+
+            for (int i = 0; i < N; ++i) {
+                Plane& plane = this->planes[i];
+                plane.is_plane = this->valid[i] and defined(i) > 0. and max_residual(i) <= threshold;
+                if (not plane.is_plane) continue;
+
+                plane.centroid = Point(Eigen::Vector3f(cx(i), cy(i), cz(i)));
+                plane.n = Normal(Eigen::Vector4f(nx(i), ny(i), nz(i), D(i)));
+            }
+        }
+
+        void PlaneFitter::fit_each(float threshold) {
+            PointVector near_points(this->k);
+
+            for (int i = 0; i < this->N; ++i) {
+                Plane& plane = this->planes[i];
+                plane.is_plane = false;
+                if (not this->valid[i]) continue;
+
+                for (int j = 0; j < this->k; ++j) near_points[j] = Point(Eigen::Vector3d(this->X(j, i), this->Y(j, i), this->Z(j, i)).cast<float>());
+
+                Eigen::Vector4f ABCD = R3Math::estimate_plane(near_points);
+                plane.is_plane = R3Math::is_plane(ABCD, near_points, threshold);
+                if (not plane.is_plane) continue;
+
+                plane.centroid = R3Math::centroid(near_points);
+                plane.n = Normal(ABCD);
+            }
+        }
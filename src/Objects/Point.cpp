@@ -34,82 +34,6 @@ extern struct Params Config;
             this->time = attributes.time;
         }
 
-        // HESAI specific
-            Point::Point(const hesai_ros::Point& p) {
-                this->set_XYZ(p);
-                this->set_attributes(p);
-                this->time = p.timestamp;
-            }
-
-            Point::Point(const hesai_ros::Point& p, double time_offset)
-                // Construct point as usual first
-                : Point::Point (p)
-            {
-                // Then add the time offset to the Point's time
-                this->time += time_offset;
-            }
-        
-        // Velodyne specific
-            Point::Point(const velodyne_ros::Point& p) {
-                this->set_XYZ(p);
-                this->set_attributes(p);
-                
-                // Time offset with respect to beginning of rotation, i.e. ~= [0, 0.1]
-                if (Config.offset_beginning) this->time = (double) p.time;
-                // Time offset with respect to end of rotation, i.e. ~= [-0.1, 0]
-                else this->time = Config.full_rotation_time + (double) p.time;
-            }
-
-            Point::Point(const velodyne_ros::Point& p, double time_offset)
-                // Construct point as usual first
-                : Point::Point (p)
-            {
-                // Then add the time offset to the Point's time
-                this->time += time_offset;
-            }
-
-        // Ouster specific
-            Point::Point(const ouster_ros::Point& p) {
-                this->set_XYZ(p);
-                this->set_attributes(p);
-
-                // Time offset with respect to beginning of rotation, i.e. ~= [0, 0.1]
-                if (Config.offset_beginning) this->time = Conversions::nanosec2Sec(p.t);
-                // Time offset with respect to end of rotation, i.e. ~= [-0.1, 0]
-                else this->time = Config.full_rotation_time + Conversions::nanosec2Sec(p.t);
-            }
-
-            Point::Point(const ouster_ros::Point& p, double time_offset)
-                // Construct point as usual first
-                : Point::Point (p)
-            {
-                // Then add the time offset to the Point's time
-                this->time += time_offset;
-            }
-
-        // Custom specific
-            Point::Point(const custom::Point& p) {
-                this->set_XYZ(p);
-
-                // -------------------------------------------
-                //      View below to modify this method
-                // -------------------------------------------
-                this->set_attributes(p);
-
-                // -------------------------------------------
-                //      Choose the appropiate time field
-                // -------------------------------------------
-                this->time = p.timestamp; // or p.time
-            }
-
-            Point::Point(const custom::Point& p, double time_offset)
-                // Construct point as usual first
-                : Point::Point (p)
-            {
-                // Then add the time offset to the Point's time
-                this->time += time_offset;
-            }
-
         full_info::Point Point::toPCL() const {
             full_info::Point p;
             p.x = this->x;
@@ -167,21 +91,6 @@ extern struct Params Config;
             this->intensity = p.intensity;
             this->range = this->norm();
         }
-        
-        // Ouster specific
-        void Point::set_attributes(const ouster_ros::Point& p) {
-            this->intensity = p.reflectivity;
-            this->range = p.range;
-        }
-
-        // ---------------------------------------------------------------------------------------
-        //      Uncomment and modify this if point type doesn't have 'intensity' as attribute
-        // ---------------------------------------------------------------------------------------
-        
-        // Point::set_attributes(const custom::Point& p) {
-        //     this->intensity = p.intensity;   // or p.reflectivity?
-        //     this->range = this->norm();      // or p.range?
-        // }
 
         void Point::pass_attributes(const Point& attributes) {
             this->intensity = attributes.intensity;
@@ -0,0 +1,45 @@
+#ifndef __OBJECTS_H__
+#define __OBJECTS_H__
+#include "Headers/Common.hpp"
+#include "Headers/Utils.hpp"
+#include "Headers/Objects.hpp"
+#include "Headers/Publishers.hpp"
+#include "Headers/PointClouds.hpp"
+#include "Headers/Accumulator.hpp"
+#include "Headers/Compensator.hpp"
+#include "Headers/Localizator.hpp"
+#include "Headers/Mapper.hpp"
+#endif
+
+extern struct Params Config;
+
+template class Queue<IMU>;
+template class Queue<Points>;
+
+// class Queue {
+    // public:
+        template <typename ContentType>
+        Queue<ContentType>::Queue(int capacity) : slots(capacity + 1), head(0), tail(0) {}
+
+        template <typename ContentType>
+        bool Queue<ContentType>::push(ContentType&& cnt) {
+            size_t t = this->tail.load(std::memory_order_relaxed);
+            size_t next_t = (t + 1) % this->slots.size();
+
+            // Full: one slot is always left empty to tell it apart from empty
+            if (next_t == this->head.load(std::memory_order_acquire)) return false;
+
+            this->slots[t] = std::move(cnt);
+            this->tail.store(next_t, std::memory_order_release);
+            return true;
+        }
+
+        template <typename ContentType>
+        bool Queue<ContentType>::pop(ContentType& cnt) {
+            size_t h = this->head.load(std::memory_order_relaxed);
+            if (h == this->tail.load(std::memory_order_acquire)) return false;
+
+            cnt = std::move(this->slots[h]);
+            this->head.store((h + 1) % this->slots.size(), std::memory_order_release);
+            return true;
+        }
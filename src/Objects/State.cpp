@@ -48,7 +48,12 @@ extern struct Params Config;
             this->w = imu.w;
         }
 
-        State::State(const state_ikfom& s, double time) : State::State (time) {
+        State::State(const state_ikfom& s, double time) : State::State () {
+            // Set time (last controls aren't known here)
+            this->time = time;
+            this->a = Eigen::Vector3f::Zero();
+            this->w = Eigen::Vector3f::Zero();
+
             // Export data from IKFoM state
             this->R = s.rot.toRotationMatrix().cast<float>();
             this->pos = s.pos.cast<float>();
@@ -0,0 +1,93 @@
+#ifndef __OBJECTS_H__
+#define __OBJECTS_H__
+#include "Headers/Common.hpp"
+#include "Headers/Utils.hpp"
+#include "Headers/Objects.hpp"
+#include "Headers/Publishers.hpp"
+#include "Headers/PointClouds.hpp"
+#include "Headers/Accumulator.hpp"
+#include "Headers/Compensator.hpp"
+#include "Headers/Localizator.hpp"
+#include "Headers/Mapper.hpp"
+#endif
+
+extern struct Params Config;
+
+// class Trajectory
+    // public:
+        Trajectory::Sample::Sample(const State& X) {
+            // Same integration as State += IMU (X.a, X.w, t)
+            Eigen::Vector3f w = X.w - X.bw;
+            
+            this->time = X.time;
+            this->R = X.R;
+            this->pos = X.pos;
+            this->vel = X.vel;
+            this->acc = X.R*(X.a - X.ba) - X.g;
+            this->ang_vel = w.norm();
+            this->axis = this->ang_vel > 0.0000001 ? Eigen::Vector3f(w / this->ang_vel) : Eigen::Vector3f::Zero();
+
+            this->RLI = X.RLI;
+            this->tLI = X.tLI;
+        }
+
+        Trajectory::Trajectory(const States& states) {
+            this->samples.reserve(states.size());
+            for (const State& X : states) this->push(X);
+        }
+
+        void Trajectory::push(const State& X) {
+            // Usually O(1), the state is the newest one
+            while (not this->samples.empty() and this->samples.back().time >= X.time) this->samples.pop_back();
+            this->samples.emplace_back(X);
+        }
+
+        bool Trajectory::empty() const {
+            return this->samples.empty();
+        }
+
+        int Trajectory::size() const {
+            return this->samples.size();
+        }
+
+        void Trajectory::clear() {
+            this->samples.clear();
+        }
+
+        void Trajectory::clear(TimeType t) {
+            // Keep the last sample before t, so t is still surrounded
+            int k = this->index(t);
+            if (k > 0) this->samples.erase(this->samples.begin(), this->samples.begin() + k);
+        }
+
+        int Trajectory::index(TimeType t) const {
+            int N = this->samples.size();
+            if (N == 0) return -1;
+            
+            const TimeType t_first = this->samples.front().time;
+            const TimeType t_last = this->samples.back().time;
+            if (t <= t_first) return 0;
+            if (t >= t_last) return N - 1;
+
+            // Samples are at IMU rate (~uniform): guess its index, then correct it
+            int k = std::min(N - 1, std::max(0, int((t - t_first) / (t_last - t_first) * (N - 1))));
+            while (k > 0 and this->samples[k].time > t) --k;
+            while (k < N - 1 and this->samples[k+1].time <= t) ++k;
+
+            return k;
+        }
+
+        RotTransl Trajectory::pose(TimeType t) const {
+            const Sample& s = this->samples[this->index(t)];
+            float dt = t - s.time;
+
+            return RotTransl(
+                s.R * SO3Math::Exp(Eigen::Vector3f(s.ang_vel*s.axis), dt),
+                s.pos + s.vel*dt + 0.5*s.acc*dt*dt
+            );
+        }
+
+        RotTransl Trajectory::lidar_pose(TimeType t) const {
+            const Sample& s = this->samples[this->index(t)];
+            return this->pose(t) * RotTransl(s.RLI, s.tLI);
+        }
@@ -0,0 +1,345 @@
+#ifndef __OBJECTS_H__
+#define __OBJECTS_H__
+#include "Headers/Common.hpp"
+#include "Headers/Utils.hpp"
+#include "Headers/Objects.hpp"
+#include "Headers/Publishers.hpp"
+#include "Headers/PointClouds.hpp"
+#include "Headers/Accumulator.hpp"
+#include "Headers/Compensator.hpp"
+#include "Headers/Localizator.hpp"
+#include "Headers/Mapper.hpp"
+#endif
+
+extern struct Params Config;
+
+namespace {
+
+    // Field 'name' is at 'offset' with the given datatype
+    bool has_field(const PointCloud_msg& msg, const std::string& name, int offset, std::uint8_t datatype) {
+        for (const sensor_msgs::PointField& field : msg->fields)
+            if (field.name == name) return field.offset == offset and field.datatype == datatype;
+
+        return false;
+    }
+
+    template <typename LayoutType>
+    bool has_xyz(const PointCloud_msg& msg) {
+        return has_field(msg, "x", offsetof(LayoutType, x), sensor_msgs::PointField::FLOAT32)
+           and has_field(msg, "y", offsetof(LayoutType, y), sensor_msgs::PointField::FLOAT32)
+           and has_field(msg, "z", offsetof(LayoutType, z), sensor_msgs::PointField::FLOAT32);
+    }
+
+    // Offset of field 'name', -1 if missing
+    int field_offset(const PointCloud_msg& msg, const std::string& name, std::uint8_t& datatype) {
+        for (const sensor_msgs::PointField& field : msg->fields) {
+            if (field.name != name) continue;
+            datatype = field.datatype;
+            return field.offset;
+        }
+
+        return -1;
+    }
+
+    // Reader of a field with a runtime datatype
+    typedef double (*FieldReader)(const std::uint8_t*);
+
+    template <typename FieldType>
+    double read_field(const std::uint8_t* data) {
+        FieldType value;
+        std::memcpy(&value, data, sizeof(FieldType));
+        return value;
+    }
+
+    FieldReader field_reader(std::uint8_t datatype) {
+        switch (datatype) {
+            case sensor_msgs::PointField::INT8: return read_field<std::int8_t>;
+            case sensor_msgs::PointField::UINT8: return read_field<std::uint8_t>;
+            case sensor_msgs::PointField::INT16: return read_field<std::int16_t>;
+            case sensor_msgs::PointField::UINT16: return read_field<std::uint16_t>;
+            case sensor_msgs::PointField::INT32: return read_field<std::int32_t>;
+            case sensor_msgs::PointField::UINT32: return read_field<std::uint32_t>;
+            case sensor_msgs::PointField::FLOAT32: return read_field<float>;
+            case sensor_msgs::PointField::FLOAT64: return read_field<double>;
+            default: return nullptr;
+        }
+    }
+
+    // Raw times to seconds, all at once (vectorizable)
+    void set_times(const PointCloud_msg& msg, const LiDARSchema& schema, double first_raw_time, double last_raw_time, const std::vector<double>& raw_times, Points& points) {
+        int N = points.size();
+        double time_offset = 0.;
+
+        // Relative times: offset by the time stamp of the earliest point
+        if (schema.relative_time) {
+            double stamp = Conversions::microsec2Sec(msg->header.stamp.toNSec() / 1000ull);
+            double begin_time = stamp + schema.time_unit*first_raw_time;
+            if (not Config.stamp_beginning) begin_time -= schema.time_unit*last_raw_time;
+
+            // Time offset with respect to beginning of rotation, i.e. ~= [0, 0.1]
+            if (Config.offset_beginning) time_offset = begin_time;
+            // Time offset with respect to end of rotation, i.e. ~= [-0.1, 0]
+            else time_offset = begin_time + Config.full_rotation_time;
+        }
+
+        std::vector<double> times(N);
+        for (int i = 0; i < N; ++i) times[i] = time_offset + schema.time_unit*raw_times[i];
+        for (int i = 0; i < N; ++i) points[i].time = times[i];
+    }
+
+    // Decimation and distance filter, applied while decoding
+    struct Decimator {
+        const DecodeFilter& filter;
+        int counter = 0;
+
+        Decimator(const DecodeFilter& filter) : filter(filter) {}
+
+        // Keep point if counter is multiple of the rate
+        bool keep_index() { return this->filter.rate <= 1 or ++this->counter%this->filter.rate == 0; }
+        bool keep_point(const Point& p) const { return this->filter.min_dist < p.norm(); }
+    };
+
+    // Points whose ring can't index a range image are dropped
+    void warn_invalid_rings(int count) {
+        ROS_WARN_THROTTLE(10, "Dropped %d points with a 'ring' out of [0, %d).", count, RangeImage::MAX_RINGS);
+    }
+
+    // Data of the k-th point of the message
+    const std::uint8_t* point_data(const PointCloud_msg& msg, int k) {
+        return msg->data.data() + (k / msg->width)*msg->row_step + (k % msg->width)*msg->point_step;
+    }
+
+    // Compile-time layouts of the known LiDAR drivers
+    template <typename LayoutType> struct DriverLayout;
+
+    template <> struct DriverLayout<velodyne_ros::Point> {
+        static bool matches(const PointCloud_msg& msg) {
+            return has_xyz<velodyne_ros::Point>(msg)
+               and has_field(msg, "intensity", offsetof(velodyne_ros::Point, intensity), sensor_msgs::PointField::FLOAT32)
+               and has_field(msg, "time", offsetof(velodyne_ros::Point, time), sensor_msgs::PointField::FLOAT32);
+        }
+
+        static bool has_ring(const PointCloud_msg& msg) {
+            return has_field(msg, "ring", offsetof(velodyne_ros::Point, ring), sensor_msgs::PointField::UINT16);
+        }
+
+        static void read(const velodyne_ros::Point& raw, Point& p, double& raw_time) {
+            p.intensity = raw.intensity;
+            p.range = p.norm();
+            raw_time = raw.time;
+        }
+    };
+
+    template <> struct DriverLayout<hesai_ros::Point> {
+        static bool matches(const PointCloud_msg& msg) {
+            return has_xyz<hesai_ros::Point>(msg)
+               and has_field(msg, "intensity", offsetof(hesai_ros::Point, intensity), sensor_msgs::PointField::UINT8)
+               and has_field(msg, "timestamp", offsetof(hesai_ros::Point, timestamp), sensor_msgs::PointField::FLOAT64);
+        }
+
+        static bool has_ring(const PointCloud_msg& msg) {
+            return has_field(msg, "ring", offsetof(hesai_ros::Point, ring), sensor_msgs::PointField::UINT16);
+        }
+
+        static void read(const hesai_ros::Point& raw, Point& p, double& raw_time) {
+            p.intensity = raw.intensity;
+            p.range = p.norm();
+            raw_time = raw.timestamp;
+        }
+    };
+
+    template <> struct DriverLayout<ouster_ros::Point> {
+        static bool matches(const PointCloud_msg& msg) {
+            return has_xyz<ouster_ros::Point>(msg)
+               and has_field(msg, "reflectivity", offsetof(ouster_ros::Point, reflectivity), sensor_msgs::PointField::UINT16)
+               and has_field(msg, "t", offsetof(ouster_ros::Point, t), sensor_msgs::PointField::UINT32)
+               and has_field(msg, "range", offsetof(ouster_ros::Point, range), sensor_msgs::PointField::UINT32);
+        }
+
+        static bool has_ring(const PointCloud_msg& msg) {
+            return has_field(msg, "ring", offsetof(ouster_ros::Point, ring), sensor_msgs::PointField::UINT8);
+        }
+
+        static void read(const ouster_ros::Point& raw, Point& p, double& raw_time) {
+            p.intensity = raw.reflectivity;
+            p.range = raw.range;
+            raw_time = raw.t;
+        }
+    };
+
+}
+
+// class LiDARDriver
+    // public:
+        Points LiDARDriver::decode(const PointCloud_msg& msg, const DecodeFilter& filter) const {
+            if (not this->exists()) return Points ();
+            if (Config.range_image_columns <= 0) return this->kernel(msg, this->schema, filter, nullptr);
+
+            // Organized scan: decode every point with its ring, then filter them on a range image
+            std::vector<int> rings;
+            Points points = this->kernel(msg, this->schema, DecodeFilter {1, -1.}, &rings);
+            
+            if (not points.empty() and rings.size() != points.size()) {
+                ROS_WARN_THROTTLE(10, "PointCloud2 has no 'ring' field, it can't be organized in a range image.");
+                return this->kernel(msg, this->schema, filter, nullptr);
+            }
+
+            RangeImage image(Config.range_image_columns);
+            image.fill(points, rings);
+            return image.filter(points, filter, Config.range_image_smoothness);
+        }
+
+        bool LiDARDriver::exists() const {
+            return this->kernel != nullptr;
+        }
+
+    // private:
+        LiDARDriver::LiDARDriver() {
+            this->resolve(Config.LiDAR_type);
+        }
+
+        void LiDARDriver::resolve(const std::string& LiDAR_type) {
+            if (LiDAR_type == LIDAR_TYPE::Velodyne) return this->set({"intensity", "time", "", 1., true}, layout_kernel<velodyne_ros::Point>);
+            if (LiDAR_type == LIDAR_TYPE::Hesai) return this->set({"intensity", "timestamp", "", 1., false}, layout_kernel<hesai_ros::Point>);
+            if (LiDAR_type == LIDAR_TYPE::Ouster) return this->set({"reflectivity", "t", "range", 1e-9, true}, layout_kernel<ouster_ros::Point>);
+            if (LiDAR_type == LIDAR_TYPE::Custom) {
+                const LiDARFieldsParams& fields = Config.LiDAR_fields;
+                return this->set({fields.intensity, fields.time, fields.range, fields.time_unit, fields.relative_time}, schema_kernel);
+            }
+
+            // Unknown LiDAR type
+            ROS_ERROR("Unknown LiDAR type! Change your YAML parameters file.");
+        }
+
+        void LiDARDriver::set(const LiDARSchema& schema, Kernel kernel) {
+            this->schema = schema;
+            this->kernel = kernel;
+        }
+
+        template <typename LayoutType>
+        Points LiDARDriver::layout_kernel(const PointCloud_msg& msg, const LiDARSchema& schema, const DecodeFilter& filter, std::vector<int>* rings) {
+            // Driver publishes a different layout than the known one, read it field by field
+            if (msg->point_step < sizeof(LayoutType) or not DriverLayout<LayoutType>::matches(msg))
+                return schema_kernel(msg, schema, filter, rings);
+
+            int N = msg->width * msg->height;
+            if (N == 0) return Points ();
+
+            // Read a whole point, offsets known at compile time
+            LayoutType raw;
+            Point p;
+            double raw_time;
+            auto read = [&](int k) {
+                std::memcpy(&raw, point_data(msg, k), sizeof(LayoutType));
+                p.x = raw.x;
+                p.y = raw.y;
+                p.z = raw.z;
+                DriverLayout<LayoutType>::read(raw, p, raw_time);
+            };
+
+            // Times of the first and last points of the message
+            read(0); double first_raw_time = raw_time;
+            read(N - 1); double last_raw_time = raw_time;
+
+            // Kept points go directly to the output
+            Points points(N / std::max(1, filter.rate) + 1);
+            std::vector<double> raw_times(points.size());
+            Decimator decimator(filter);
+            int n = 0;
+
+            // Rings (if asked and given)
+            bool read_rings = rings and DriverLayout<LayoutType>::has_ring(msg);
+            if (rings) rings->assign(read_rings ? points.size() : 0, 0);
+            int invalid_rings = 0;
+
+            // One pass over the message's data
+            for (int k = 0; k < N; ++k) {
+                if (not decimator.keep_index()) continue;
+                read(k);
+                if (not decimator.keep_point(p)) continue;
+
+                if (read_rings) {
+                    if (not RangeImage::valid_ring(raw.ring)) { ++invalid_rings; continue; }
+                    (*rings)[n] = raw.ring;
+                }
+
+                points[n] = p;
+                raw_times[n++] = raw_time;
+            }
+
+            points.resize(n);
+            raw_times.resize(n);
+            if (read_rings) rings->resize(n);
+            if (invalid_rings > 0) warn_invalid_rings(invalid_rings);
+            set_times(msg, schema, first_raw_time, last_raw_time, raw_times, points);
+            return points;
+        }
+
+        Points LiDARDriver::schema_kernel(const PointCloud_msg& msg, const LiDARSchema& schema, const DecodeFilter& filter, std::vector<int>* rings) {
+            int N = msg->width * msg->height;
+            if (N == 0) return Points ();
+
+            // Where each field is inside a point
+            std::uint8_t x_type = 0, y_type = 0, z_type = 0, i_type = 0, t_type = 0, r_type = 0, ring_type = 0;
+            int x_off = field_offset(msg, "x", x_type);
+            int y_off = field_offset(msg, "y", y_type);
+            int z_off = field_offset(msg, "z", z_type);
+            int i_off = field_offset(msg, schema.intensity_field, i_type);
+            int t_off = field_offset(msg, schema.time_field, t_type);
+            int r_off = schema.range_field.empty() ? -1 : field_offset(msg, schema.range_field, r_type);
+            int ring_off = rings ? field_offset(msg, "ring", ring_type) : -1;
+
+            bool xyz_float = x_type == sensor_msgs::PointField::FLOAT32 and y_type == sensor_msgs::PointField::FLOAT32 and z_type == sensor_msgs::PointField::FLOAT32;
+            FieldReader read_intensity = i_off < 0 ? nullptr : field_reader(i_type);
+            FieldReader read_time = t_off < 0 ? nullptr : field_reader(t_type);
+            FieldReader read_range = r_off < 0 ? nullptr : field_reader(r_type);
+            FieldReader read_ring = ring_off < 0 ? nullptr : field_reader(ring_type);
+
+            if (x_off < 0 or y_off < 0 or z_off < 0 or not xyz_float or not read_intensity or not read_time or (not schema.range_field.empty() and not read_range)) {
+                ROS_ERROR("PointCloud2 fields don't match the LiDAR type! Change your YAML parameters file.");
+                return Points ();
+            }
+
+            // Times of the first and last points of the message
+            double first_raw_time = read_time(point_data(msg, 0) + t_off);
+            double last_raw_time = read_time(point_data(msg, N - 1) + t_off);
+
+            // Kept points go directly to the output
+            Points points(N / std::max(1, filter.rate) + 1);
+            std::vector<double> raw_times(points.size());
+            Decimator decimator(filter);
+            int n = 0;
+
+            // Rings (if asked and given)
+            if (rings) rings->assign(read_ring ? points.size() : 0, 0);
+            int invalid_rings = 0;
+
+            // One pass over the message's data, only kept points are fully read
+            for (int k = 0; k < N; ++k) {
+                if (not decimator.keep_index()) continue;
+                const std::uint8_t* data = point_data(msg, k);
+
+                Point& p = points[n];
+                std::memcpy(&p.x, data + x_off, sizeof(float));
+                std::memcpy(&p.y, data + y_off, sizeof(float));
+                std::memcpy(&p.z, data + z_off, sizeof(float));
+                if (not decimator.keep_point(p)) continue;
+
+                if (read_ring) {
+                    double ring = read_ring(data + ring_off);
+                    if (not RangeImage::valid_ring(ring)) { ++invalid_rings; continue; }
+                    (*rings)[n] = ring;
+                }
+
+                p.intensity = read_intensity(data + i_off);
+                p.range = read_range ? read_range(data + r_off) : p.norm();
+                raw_times[n++] = read_time(data + t_off);
+            }
+
+            points.resize(n);
+            raw_times.resize(n);
+            if (read_ring) rings->resize(n);
+            if (invalid_rings > 0) warn_invalid_rings(invalid_rings);
+            set_times(msg, schema, first_raw_time, last_raw_time, raw_times, points);
+            return points;
+        }
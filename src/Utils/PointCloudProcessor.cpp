@@ -15,111 +15,80 @@ extern struct Params Config;
 
 // class PointCloudProcessor
     // public:
-        Points PointCloudProcessor::downsample(const Points& points) {
-            // Downsample points close depending on their time distance
-            return this->temporal_downsample(points);
-        }
+        Points PointCloudProcessor::process(const PointCloud_msg& msg) {
+            // Decode, filter by distance and downsample in a single pass
+            Points points = LiDARDriver::getInstance().decode(msg, DecodeFilter {Config.downsample_rate, Config.min_dist});
 
-    // private:
-        Points PointCloudProcessor::msg2points(const PointCloud_msg& msg) {
-            if (Config.LiDAR_type == LIDAR_TYPE::Velodyne) return this->velodynemsg2points(msg);
-            if (Config.LiDAR_type == LIDAR_TYPE::Hesai) return this->hesaimsg2points(msg);
-            if (Config.LiDAR_type == LIDAR_TYPE::Ouster) return this->oustermsg2points(msg);
-            if (Config.LiDAR_type == LIDAR_TYPE::Custom) return this->custommsg2points(msg);
-            
-            // Unknown LiDAR type
-            ROS_ERROR("Unknown LiDAR type! Change your YAML parameters file.");
-            return Points ();
+            // Then sort them in place
+            this->sort_points(points);
+            return points;
         }
 
-        // Velodyne specific
-            Points PointCloudProcessor::velodynemsg2points(const PointCloud_msg& msg) {
-                pcl::PointCloud<velodyne_ros::Point>::Ptr raw_pcl(new pcl::PointCloud<velodyne_ros::Point>());
-                pcl::fromROSMsg(*msg, *raw_pcl);
-                return this->to_points(*raw_pcl);
-            }
-
-            double PointCloudProcessor::get_begin_time(const pcl::PointCloud<velodyne_ros::Point>& pcl) {
-                // Velodyne points have relative time
-                if (Config.stamp_beginning) return Conversions::microsec2Sec(pcl.header.stamp) + pcl.points.front().time;
-                else return Conversions::microsec2Sec(pcl.header.stamp) + pcl.points.front().time - pcl.points.back().time;
-            }
-
-        // HESAI specific
-            Points PointCloudProcessor::hesaimsg2points(const PointCloud_msg& msg) {
-                pcl::PointCloud<hesai_ros::Point>::Ptr raw_pcl(new pcl::PointCloud<hesai_ros::Point>());
-                pcl::fromROSMsg(*msg, *raw_pcl);
-                return this->to_points(*raw_pcl);
-            }
-
-            double PointCloudProcessor::get_begin_time(const pcl::PointCloud<hesai_ros::Point>& pcl) {
-                // HESAI points have absolute time
-                return 0.d;
-            }
-
-        // Ouster specific
-            Points PointCloudProcessor::oustermsg2points(const PointCloud_msg& msg) {
-                pcl::PointCloud<ouster_ros::Point>::Ptr raw_pcl(new pcl::PointCloud<ouster_ros::Point>());
-                pcl::fromROSMsg(*msg, *raw_pcl);
-                return this->to_points(*raw_pcl);
-            }
-
-            double PointCloudProcessor::get_begin_time(const pcl::PointCloud<ouster_ros::Point>& pcl) {
-                // Ouster points have relative time
-                if (Config.stamp_beginning) return Conversions::microsec2Sec(pcl.header.stamp) + Conversions::nanosec2Sec(pcl.points.front().t);
-                else return Conversions::microsec2Sec(pcl.header.stamp) + Conversions::nanosec2Sec(pcl.points.front().t) - Conversions::nanosec2Sec(pcl.points.back().t);
-            }
+        void PointCloudProcessor::sort_points(Points& points) {
+            // Spinning LiDARs give (almost) sorted points: columns in order, or a sorted run per ring
+            std::vector<int> runs = this->time_runs(points);
+            int Nruns = runs.size() - 1;
+            if (Nruns <= 1) return;
 
-        // Custom specific
-            Points PointCloudProcessor::custommsg2points(const PointCloud_msg& msg) {
-                pcl::PointCloud<custom::Point>::Ptr raw_pcl(new pcl::PointCloud<custom::Point>());
-                pcl::fromROSMsg(*msg, *raw_pcl);
-                return this->to_points(*raw_pcl);
+            // Unstructured pointcloud (runs are too short), use std::sort included in <algorithms>
+            if (points.size() < 8*Nruns) {
+                std::sort(points.begin(), points.end(), this->time_sort);
+                return;
             }
 
-            // Change this to fit the timestamp of the first point
-            double PointCloudProcessor::get_begin_time(const pcl::PointCloud<custom::Point>& pcl) {
-                // // Example: Points with relative time
-                // if (Config.stamp_beginning) return Conversions::microsec2Sec(pcl.header.stamp) + pcl.points.front().time;
-                // else return Conversions::microsec2Sec(pcl.header.stamp) + pcl.points.front().time - pcl.points.back().time;
-                
-                // Example: Points with absolute time
-                return 0.d;
-            }
-
-        template <typename PointType>
-        Points PointCloudProcessor::to_points(const typename pcl::PointCloud<PointType>& pcl) {
-            Points pts;
-
-            // Special case: Velodyne points have relative time, we need to get the time stamp from the earliest point
-            double begin_time = this->get_begin_time(pcl);
+            // Otherwise merge the runs, O(N log(runs))
+            this->merge_runs(points, runs);
+        }
 
-            for (PointType p : pcl.points) pts.push_back(Point (p, begin_time));
-            return pts;
+    // private:
+        bool PointCloudProcessor::time_sort(const Point& a, const Point& b) {
+            return a.time < b.time;
         }
 
-        Points PointCloudProcessor::temporal_downsample(const Points& points) {
-            Points downsampled;
-            int ds_counter = 0;
+        // Beginnings of the runs of non-decreasing time (and points.size() at the end)
+        std::vector<int> PointCloudProcessor::time_runs(const Points& points) {
+            std::vector<int> runs;
+            if (points.empty()) return runs;
 
-            for (Point p : points) {
-                // Keep point if counter is multiple of downsample_rate
-                bool keep_point = Config.downsample_rate <= 1 or ++ds_counter%Config.downsample_rate == 0; 
-                if (keep_point and Config.min_dist < p.norm()) downsampled.push_back(p);
-            }
+            runs.push_back(0);
+            for (int i = 1; i < points.size(); ++i)
+                if (points[i].time < points[i-1].time) runs.push_back(i);
 
-            return downsampled;
+            runs.push_back(points.size());
+            return runs;
         }
 
-        bool PointCloudProcessor::time_sort(const Point& a, const Point& b) {
-            return a.time < b.time;
-        }
+        // Bottom-up merge of consecutive runs, pairwise until only one is left
+        void PointCloudProcessor::merge_runs(Points& points, std::vector<int>& runs) {
+            Points scratch(points.size());
+            Points* src = &points;
+            Points* dst = &scratch;
+
+            while (runs.size() > 2) {
+                int Nruns = runs.size() - 1;
+                std::vector<int> merged_runs;
+                merged_runs.reserve(Nruns/2 + 2);
+
+                for (int r = 0; r < Nruns; r += 2) {
+                    int begin = runs[r];
+                    int middle = runs[r+1];
+                    int end = runs[std::min(r+2, Nruns)];
+
+                    std::merge(
+                        src->begin() + begin, src->begin() + middle,
+                        src->begin() + middle, src->begin() + end,
+                        dst->begin() + begin, this->time_sort
+                    );
+
+                    merged_runs.push_back(begin);
+                }
+
+                merged_runs.push_back(points.size());
+                runs.swap(merged_runs);
+                std::swap(src, dst);
+            }
 
-        Points PointCloudProcessor::sort_points(const Points& points) {
-            Points sorted_points = points;
-            // Use std::sort included in <algorithms>
-            std::sort(sorted_points.begin(), sorted_points.end(), this->time_sort);
-            return sorted_points;
+            if (src != &points) points.swap(scratch);
         }
 
 void Processor::fill(pcl::PointCloud<full_info::Point>& pcl, const Points& points) {
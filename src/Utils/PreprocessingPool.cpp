@@ -0,0 +1,93 @@
+#ifndef __OBJECTS_H__
+#define __OBJECTS_H__
+#include "Headers/Common.hpp"
+#include "Headers/Utils.hpp"
+#include "Headers/Objects.hpp"
+#include "Headers/Publishers.hpp"
+#include "Headers/PointClouds.hpp"
+#include "Headers/Accumulator.hpp"
+#include "Headers/Compensator.hpp"
+#include "Headers/Localizator.hpp"
+#include "Headers/Mapper.hpp"
+#endif
+
+extern struct Params Config;
+
+// class PreprocessingPool
+    // public:
+        PreprocessingPool::PreprocessingPool(int threads, int capacity, Output output)
+            : output(output), threads(std::max(1, threads)), capacity(std::max(1, capacity))
+        {}
+
+        PreprocessingPool::~PreprocessingPool() {
+            std::unique_lock<std::mutex> lock(this->mtx);
+            this->stopping = true;
+            this->space_condition.notify_all();
+
+            // The pool's tasks use this object until they finish
+            this->idle_condition.wait(lock, [this] { return this->running == 0; });
+        }
+
+        void PreprocessingPool::submit(const PointCloud_msg& msg) {
+            std::unique_lock<std::mutex> lock(this->mtx);
+
+            // Bounded: wait until the oldest messages have been handed over
+            this->space_condition.wait(lock, [this] {
+                return this->stopping or this->next_submitted - this->next_released < this->capacity;
+            });
+            if (this->stopping) return;
+
+            this->jobs.push_back(Job {this->next_submitted++, msg});
+
+            // At most 'threads' of the pool's threads busy with messages
+            if (this->running >= this->threads) return;
+            ++this->running;
+            lock.unlock();
+
+            ThreadPool::getInstance().submit([this] { this->work(); });
+        }
+
+    // private:
+        void PreprocessingPool::work() {
+            while (true) {
+                Job job;
+
+                {
+                    std::lock_guard<std::mutex> lock(this->mtx);
+                    if (this->stopping or this->jobs.empty()) {
+                        --this->running;
+                        this->idle_condition.notify_all();
+                        return;
+                    }
+
+                    job = std::move(this->jobs.front());
+                    this->jobs.pop_front();
+                }
+
+                // Process the message concurrently with the other messages
+                auto begin = std::chrono::steady_clock::now();
+                PointCloudProcessor processor;
+                Points points = processor.process(job.msg);
+                auto end = std::chrono::steady_clock::now();
+                Metrics::getInstance().add("Ingestion - Preprocess (us)", std::chrono::duration<double, std::micro>(end - begin).count());
+
+                this->release(job.sequence, std::move(points));
+            }
+        }
+
+        void PreprocessingPool::release(long sequence, Points&& points) {
+            {
+                std::lock_guard<std::mutex> lock(this->mtx);
+                this->processed.emplace(sequence, std::move(points));
+
+                // Hand over every consecutive processed message (one thread at a time)
+                auto it = this->processed.begin();
+                while (it != this->processed.end() and it->first == this->next_released) {
+                    this->output(std::move(it->second));
+                    it = this->processed.erase(it);
+                    ++this->next_released;
+                }
+            }
+
+            this->space_condition.notify_all();
+        }
@@ -0,0 +1,114 @@
+#ifndef __OBJECTS_H__
+#define __OBJECTS_H__
+#include "Headers/Common.hpp"
+#include "Headers/Utils.hpp"
+#include "Headers/Objects.hpp"
+#include "Headers/Publishers.hpp"
+#include "Headers/PointClouds.hpp"
+#include "Headers/Accumulator.hpp"
+#include "Headers/Compensator.hpp"
+#include "Headers/Localizator.hpp"
+#include "Headers/Mapper.hpp"
+#endif
+
+extern struct Params Config;
+
+// class RangeImage
+    // public:
+        RangeImage::RangeImage(int columns) : columns(std::max(1, columns)) {}
+
+        bool RangeImage::valid_ring(double ring) {
+            // Also false for NaN (float 'ring' fields of custom LiDARs)
+            return ring >= 0 and ring < RangeImage::MAX_RINGS;
+        }
+
+        void RangeImage::fill(const Points& points, const std::vector<int>& point_rings) {
+            this->rings = 0;
+            for (int ring : point_rings) this->rings = std::max(this->rings, ring + 1);
+            this->cells.assign(this->rings * this->columns, -1);
+
+            // First point of each cell
+            for (int i = 0; i < points.size(); ++i) {
+                int& cell = this->cells[point_rings[i]*this->columns + this->column(points[i])];
+                if (cell < 0) cell = i;
+            }
+        }
+
+        int RangeImage::at(int ring, int column) const {
+            // Columns wrap around
+            column = (column % this->columns + this->columns) % this->columns;
+            return this->cells[ring*this->columns + column];
+        }
+
+        int RangeImage::column(const Point& p) const {
+            float azimuth = std::atan2(p.y, p.x) + M_PI;
+            int c = azimuth / (2*M_PI) * this->columns;
+            return std::min(c, this->columns - 1);
+        }
+
+        Points RangeImage::filter(const Points& points, const DecodeFilter& filter, float smoothness) const {
+            Points filtered;
+            if (points.empty()) return filtered;
+            int rate = std::max(1, filter.rate);
+            filtered.reserve(points.size() / rate + 1);
+
+            // Start where the scan starts and follow the sensor, so columns come out in time order
+            auto time_sort = [](const Point& a, const Point& b) { return a.time < b.time; };
+            const Point& first = *std::min_element(points.begin(), points.end(), time_sort);
+            int first_column = this->column(first);
+            int step = this->spin(points, first);
+
+            for (int k = 0; k < this->columns; k += rate) {
+                int c = ((first_column + step*k) % this->columns + this->columns) % this->columns;
+                int column_begin = filtered.size();
+
+                for (int r = 0; r < this->rings; ++r) {
+                    int i = this->cells[r*this->columns + c];
+                    if (i < 0) continue;
+
+                    const Point& p = points[i];
+                    if (p.norm() <= filter.min_dist) continue;
+                    if (smoothness > 0 and not this->is_smooth(points, r, c, smoothness)) continue;
+
+                    filtered.push_back(p);
+                }
+
+                // Lasers of a column aren't fired in ring order
+                std::sort(filtered.begin() + column_begin, filtered.end(), time_sort);
+            }
+
+            return filtered;
+        }
+
+    // private:
+        bool RangeImage::is_smooth(const Points& points, int ring, int column, float smoothness) const {
+            // Mean range of the two closest cells at each side in the same ring
+            float sum = 0;
+            int count = 0;
+
+            for (int dc : {-2, -1, 1, 2}) {
+                int i = this->at(ring, column + dc);
+                if (i < 0) continue;
+                sum += points[i].norm();
+                ++count;
+            }
+
+            // Isolated points can't be checked
+            if (count < 2) return true;
+
+            float range = points[this->at(ring, column)].norm();
+            return std::abs(range - sum/count) <= smoothness*range;
+        }
+
+        int RangeImage::spin(const Points& points, const Point& first) const {
+            // Column the scan reached a quarter of the way through: +1 if azimuth grows with time (counterclockwise), -1 otherwise
+            TimeType last_time = std::max_element(points.begin(), points.end(), [](const Point& a, const Point& b) { return a.time < b.time; })->time;
+            TimeType quarter_time = first.time + (last_time - first.time)/4;
+
+            const Point* quarter = &first;
+            for (const Point& p : points)
+                if (std::abs(p.time - quarter_time) < std::abs(quarter->time - quarter_time)) quarter = &p;
+
+            int steps = ((this->column(*quarter) - this->column(first)) % this->columns + this->columns) % this->columns;
+            return steps <= this->columns/2 ? 1 : -1;
+        }
@@ -0,0 +1,164 @@
+#ifndef __OBJECTS_H__
+#define __OBJECTS_H__
+#include "Headers/Common.hpp"
+#include "Headers/Utils.hpp"
+#include "Headers/Objects.hpp"
+#include "Headers/Publishers.hpp"
+#include "Headers/PointClouds.hpp"
+#include "Headers/Accumulator.hpp"
+#include "Headers/Compensator.hpp"
+#include "Headers/Localizator.hpp"
+#include "Headers/Mapper.hpp"
+#endif
+
+#include <pthread.h>
+
+extern struct Params Config;
+
+thread_local int ThreadPool::current_thread = 0;
+
+// class ThreadPool
+    // public:
+        void ThreadPool::start(int threads, const std::vector<int>& cpus) {
+            if (not this->workers.empty()) {
+                ROS_WARN("Thread pool already started, ignoring the new size.");
+                return;
+            }
+
+            // One thread per given CPU, or per core if none
+            if (threads <= 0) threads = cpus.empty() ? std::max(1u, std::thread::hardware_concurrency()) : cpus.size();
+            if (not cpus.empty() and threads > (int) cpus.size()) ROS_WARN("%d threads on %d CPUs, some of them will share a core.", threads, (int) cpus.size());
+
+            // The caller (and the threads it creates from now on) can run on any of the given CPUs
+            if (not cpus.empty()) ThreadPool::pin(pthread_self(), cpus);
+
+            // The caller is one of the threads
+            for (int k = 0; k < threads - 1; ++k) this->workers.emplace_back(new Worker());
+            for (int k = 0; k < threads - 1; ++k) {
+                this->workers[k]->thread = std::thread(&ThreadPool::work, this, k);
+                if (not cpus.empty()) ThreadPool::pin(this->workers[k]->thread.native_handle(), {cpus[k % cpus.size()]});
+            }
+        }
+
+        int ThreadPool::size() const {
+            return this->workers.size() + 1;
+        }
+
+        void ThreadPool::parallel_for(int N, int grain, const Body& body) {
+            if (N <= 0) return;
+            grain = std::max(1, grain);
+            int chunks = (N + grain - 1) / grain;
+
+            // Not worth waking anyone up
+            if (chunks == 1 or this->workers.empty()) {
+                body(0, N, ThreadPool::current_thread);
+                return;
+            }
+
+            std::shared_ptr<Loop> loop = std::make_shared<Loop>();
+            loop->body = &body;
+            loop->N = N;
+            loop->grain = grain;
+            loop->chunks = chunks;
+            loop->next.store(0);
+            loop->done.store(0);
+
+            // One helper per worker at most, idle workers steal the ones queued behind busy ones
+            int helpers = std::min<int>(chunks - 1, this->workers.size());
+            for (int h = 0; h < helpers; ++h) {
+                int k = this->next_worker.fetch_add(1) % this->workers.size();
+                this->push(k, [loop] { while (ThreadPool::run_chunk(*loop, ThreadPool::current_thread)); });
+            }
+
+            // Help, then wait for the chunks others took (the body can't be used after returning)
+            while (ThreadPool::run_chunk(*loop, ThreadPool::current_thread));
+            while (loop->done.load() < chunks) std::this_thread::yield();
+        }
+
+        void ThreadPool::submit(std::function<void()> task) {
+            if (this->workers.empty()) {
+                task();
+                return;
+            }
+
+            int k = this->next_worker.fetch_add(1) % this->workers.size();
+            this->push(k, std::move(task));
+        }
+
+    // private:
+        void ThreadPool::work(int k) {
+            ThreadPool::current_thread = k + 1;
+
+            while (true) {
+                Task task;
+                if (this->pop(k, task)) {
+                    task();
+                    continue;
+                }
+
+                // Sleep until anything is queued anywhere
+                std::unique_lock<std::mutex> lock(this->sleep_mtx);
+                this->sleep_condition.wait(lock, [this] { return this->pending.load() > 0; });
+            }
+        }
+
+        void ThreadPool::push(int k, Task&& task) {
+            {
+                std::lock_guard<std::mutex> lock(this->workers[k]->mtx);
+                this->workers[k]->tasks.push_back(std::move(task));
+            }
+
+            {
+                // Under the sleep lock so a worker about to sleep can't miss it
+                std::lock_guard<std::mutex> lock(this->sleep_mtx);
+                this->pending.fetch_add(1);
+            }
+
+            this->sleep_condition.notify_all();
+        }
+
+        bool ThreadPool::pop(int k, Task& task) {
+            int Nworkers = this->workers.size();
+
+            // Own queue first (oldest task), then steal the newest task of the others
+            for (int i = 0; i < Nworkers; ++i) {
+                Worker& worker = *this->workers[(k + i) % Nworkers];
+                std::lock_guard<std::mutex> lock(worker.mtx);
+                if (worker.tasks.empty()) continue;
+
+                if (i == 0) {
+                    task = std::move(worker.tasks.front());
+                    worker.tasks.pop_front();
+                }
+                else {
+                    task = std::move(worker.tasks.back());
+                    worker.tasks.pop_back();
+                }
+
+                this->pending.fetch_sub(1);
+                return true;
+            }
+
+            return false;
+        }
+
+        bool ThreadPool::run_chunk(Loop& loop, int thread) {
+            int chunk = loop.next.fetch_add(1);
+            if (chunk >= loop.chunks) return false;
+
+            int first = chunk * loop.grain;
+            int last = std::min(loop.N, first + loop.grain);
+            (*loop.body)(first, last, thread);
+
+            loop.done.fetch_add(1);
+            return true;
+        }
+
+        void ThreadPool::pin(std::thread::native_handle_type thread, const std::vector<int>& cpus) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            for (int cpu : cpus) CPU_SET(cpu, &set);
+
+            if (pthread_setaffinity_np(thread, sizeof(cpu_set_t), &set) != 0)
+                ROS_WARN("Could not pin a thread to CPU %d%s.", cpus.front(), cpus.size() > 1 ? " (and the rest of threads_affinity)" : "");
+        }
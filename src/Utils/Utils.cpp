@@ -70,4 +70,24 @@ Point R3Math::centroid(const PointVector& pts) {
     Eigen::Matrix<float, 3, 1> centroid_vect;
     for (Point p : pts) centroid_vect += p.toEigen();
     return Point (centroid_vect/N);
+}
+
+void Metrics::add(const std::string& name, double value) {
+    std::lock_guard<std::mutex> lock(this->mtx);
+    Stats& st = this->stats[name];
+    st.sum += value;
+    st.max = st.count > 0 ? std::max(st.max, value) : value;
+    ++st.count;
+}
+
+void Metrics::clear() {
+    std::lock_guard<std::mutex> lock(this->mtx);
+    this->stats.clear();
+}
+
+std::map<std::string, Metrics::Stats> Metrics::take() {
+    std::map<std::string, Stats> taken;
+    std::lock_guard<std::mutex> lock(this->mtx);
+    taken.swap(this->stats);
+    return taken;
 }
\ No newline at end of file
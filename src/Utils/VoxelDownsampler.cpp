@@ -0,0 +1,197 @@
+#ifndef __OBJECTS_H__
+#define __OBJECTS_H__
+#include "Headers/Common.hpp"
+#include "Headers/Utils.hpp"
+#include "Headers/Objects.hpp"
+#include "Headers/Publishers.hpp"
+#include "Headers/PointClouds.hpp"
+#include "Headers/Accumulator.hpp"
+#include "Headers/Compensator.hpp"
+#include "Headers/Localizator.hpp"
+#include "Headers/Mapper.hpp"
+#endif
+
+extern struct Params Config;
+
+// class VoxelDownsampler
+    // public:
+        Points VoxelDownsampler::filter(const PointsView& points, float precision, Mode mode, int threads) {
+            if (points.empty()) return Points();
+
+            threads = std::max(1, threads);
+            if (this->tables.size() < threads) this->tables.resize(threads);
+
+            float inv_precision = 1. / precision;
+
+            if (threads == 1) {
+                Table& table = this->tables[0];
+                table.reset(points.size());
+                for (const Point& p : points) VoxelDownsampler::accumulate(table.find(VoxelDownsampler::key(p, inv_precision), p), p, mode);
+            }
+            else this->filter_partitions(points, inv_precision, mode, threads);
+
+            int Nvoxels = 0;
+            for (int t = 0; t < threads; ++t) Nvoxels += this->tables[t].voxels.size();
+
+            Points ds_points;
+            ds_points.reserve(Nvoxels);
+
+            for (int t = 0; t < threads; ++t) {
+                for (const Voxel& v : this->tables[t].voxels) {
+                    if (mode == First) {
+                        ds_points.push_back(v.first);
+                        continue;
+                    }
+
+                    Point p = v.first;
+                    p.x = v.x / v.count;
+                    p.y = v.y / v.count;
+                    p.z = v.z / v.count;
+                    p.time = v.time / v.count;
+                    p.intensity = v.intensity / v.count;
+                    p.range = v.range / v.count;
+                    ds_points.push_back(p);
+                }
+            }
+
+            return ds_points;
+        }
+
+        std::uint64_t VoxelDownsampler::key(const Point& p, float inv_precision) {
+            return VoxelDownsampler::key(std::floor(p.x * inv_precision), std::floor(p.y * inv_precision), std::floor(p.z * inv_precision));
+        }
+
+        std::uint64_t VoxelDownsampler::key(std::int64_t i, std::int64_t j, std::int64_t k) {
+            // 21 bits per axis
+            return (std::uint64_t(i) & 0x1FFFFF) << 42 | (std::uint64_t(j) & 0x1FFFFF) << 21 | (std::uint64_t(k) & 0x1FFFFF);
+        }
+
+    // private:
+        /*
+            Each thread keeps the voxels of its partition, visiting only their points:
+                1. key and partition of every point, counting them per chunk
+                2. points grouped by partition (in their order within it), each chunk writes where its counts say
+                3. one task per partition fills its table
+        */
+        void VoxelDownsampler::filter_partitions(const PointsView& points, float inv_precision, Mode mode, int threads) {
+            ThreadPool& pool = ThreadPool::getInstance();
+            const std::vector<PointsView::Span>& spans = points.spans;
+            int N = points.size();
+            int grain = std::max(1024, N/(4*threads) + 1);
+            int chunks = (N + grain - 1) / grain;
+
+            // Index of the first point of each span
+            std::vector<int> span_starts;
+            span_starts.reserve(spans.size());
+            for (int s = 0, n = 0; s < spans.size(); n += spans[s].second - spans[s].first, ++s) span_starts.push_back(n);
+
+            this->keys.resize(N);
+            this->partitions.resize(N);
+            this->inputs.resize(N);
+            this->grouped.resize(N);
+            this->counts.assign(chunks*threads, 0);
+
+            pool.parallel_for(N, grain, [&](int first, int last, int) {
+                int s = std::upper_bound(span_starts.begin(), span_starts.end(), first) - span_starts.begin() - 1;
+                const Point* p = spans[s].first + (first - span_starts[s]);
+                int* count = &this->counts[(first/grain)*threads];
+
+                for (int i = first; i < last; ++i, ++p) {
+                    if (p == spans[s].second) p = spans[++s].first;
+                    this->keys[i] = VoxelDownsampler::key(*p, inv_precision);
+                    this->partitions[i] = VoxelDownsampler::partition(this->keys[i], threads);
+                    this->inputs[i] = p;
+                    ++count[this->partitions[i]];
+                }
+            });
+
+            // Counts to positions: partitions one after the other, chunks in order within each one
+            std::vector<int> bounds(threads + 1, N);
+            for (int t = 0, position = 0; t < threads; ++t) {
+                bounds[t] = position;
+                for (int c = 0; c < chunks; ++c) {
+                    int& count = this->counts[c*threads + t];
+                    int n = count;
+                    count = position;
+                    position += n;
+                }
+            }
+
+            pool.parallel_for(N, grain, [&](int first, int last, int) {
+                int* next = &this->counts[(first/grain)*threads];
+                for (int i = first; i < last; ++i) this->grouped[next[this->partitions[i]]++] = i;
+            });
+
+            pool.parallel_for(threads, 1, [&](int t, int, int) {
+                Table& table = this->tables[t];
+                table.reset(bounds[t+1] - bounds[t]);
+
+                for (int j = bounds[t]; j < bounds[t+1]; ++j) {
+                    int i = this->grouped[j];
+                    VoxelDownsampler::accumulate(table.find(this->keys[i], *this->inputs[i]), *this->inputs[i], mode);
+                }
+            });
+        }
+
+        void VoxelDownsampler::accumulate(Voxel& v, const Point& p, Mode mode) {
+            if (mode == First) return;
+
+            v.x += p.x;
+            v.y += p.y;
+            v.z += p.z;
+            v.time += p.time;
+            v.intensity += p.intensity;
+            v.range += p.range;
+            ++v.count;
+        }
+
+        std::uint64_t VoxelDownsampler::hash(std::uint64_t key) {
+            // Fibonacci hashing
+            return key * 0x9E3779B97F4A7C15ull;
+        }
+
+        int VoxelDownsampler::partition(std::uint64_t key, int threads) {
+            // Top bits of the hash (slots use the bottom ones)
+            std::uint64_t h = VoxelDownsampler::hash(key) >> 32;
+            return (h * threads) >> 32;
+        }
+
+        void VoxelDownsampler::Table::reset(int max_voxels) {
+            this->voxels.clear();
+
+            // At most half full, only allocate if it has never been this big
+            int capacity = 16;
+            while (capacity < 2*max_voxels) capacity *= 2;
+
+            if (capacity > this->keys.size()) {
+                this->keys.assign(capacity, 0);
+                this->generations.assign(capacity, 0);
+                this->slots.assign(capacity, 0);
+                this->voxels.reserve(max_voxels);
+                this->mask = capacity - 1;
+                this->generation = 0;
+            }
+
+            // New generation: every slot is empty without touching them
+            if (++this->generation == 0) {
+                std::fill(this->generations.begin(), this->generations.end(), 0);
+                this->generation = 1;
+            }
+        }
+
+        VoxelDownsampler::Voxel& VoxelDownsampler::Table::find(std::uint64_t key, const Point& p) {
+            // Linear probing
+            int slot = (VoxelDownsampler::hash(key) >> 32) & this->mask;
+            while (this->generations[slot] == this->generation) {
+                if (this->keys[slot] == key) return this->voxels[this->slots[slot]];
+                slot = (slot + 1) & this->mask;
+            }
+
+            // New voxel
+            this->generations[slot] = this->generation;
+            this->keys[slot] = key;
+            this->slots[slot] = this->voxels.size();
+            this->voxels.push_back(Voxel {p, 0., 0., 0., 0., 0., 0., 0});
+
+            return this->voxels.back();
+        }
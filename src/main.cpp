@@ -22,6 +22,12 @@ int main(int argc, char** argv) {
     // Fill configurations Params with YAML
     fill_config(nh);
 
+    // Workers shared by every parallel stage
+    ThreadPool::getInstance().start(Config.threads, Config.threads_affinity);
+
+    // Resolve how to decode the LiDAR once (warns if unknown)
+    LiDARDriver::getInstance();
+
     // Objects
     Publishers publish(nh);
     Accumulator& accum = Accumulator::getInstance();
@@ -29,27 +35,46 @@ int main(int argc, char** argv) {
     Mapper& map = Mapper::getInstance();
     Localizator& loc = Localizator::getInstance();
 
-    // Subscribers
-    ros::Subscriber lidar_sub = nh.subscribe(
+    // Subscribers (each one on its own thread)
+    ros::NodeHandle lidar_nh, imu_nh;
+    ros::CallbackQueue lidar_queue, imu_queue;
+    lidar_nh.setCallbackQueue(&lidar_queue);
+    imu_nh.setCallbackQueue(&imu_queue);
+
+    ros::Subscriber lidar_sub = lidar_nh.subscribe(
         Config.points_topic, 1000,
         &Accumulator::receive_lidar, &accum
     );
 
-    ros::Subscriber imu_sub = nh.subscribe(
+    ros::Subscriber imu_sub = imu_nh.subscribe(
         Config.imus_topic, 1000,
         &Accumulator::receive_imu, &accum
     );
 
+    ros::AsyncSpinner lidar_spinner(1, &lidar_queue);
+    ros::AsyncSpinner imu_spinner(1, &imu_queue);
+    lidar_spinner.start();
+    imu_spinner.start();
+
     // Time variables
     double t1, t2;
     t2 = DBL_MAX;
 
     // (Delta = t2 - t1) Size of the field of view we use to localize
     double delta = Config.Initialization.deltas.front();
-    
-    ros::Rate rate(5000);
+
+    // Time the received data has to cover to process the next window
+    double awaited_t2 = DBL_MAX;
 
     while (ros::ok()) {
+
+        // Sleep until the next window can be processed (or timeout)
+        accum.wait_data(awaited_t2);
+        if (Config.print_metrics) publish.metrics(Metrics::getInstance());
+
+        // Get the data received by the subscribers
+        accum.drain_queues();
+        awaited_t2 = DBL_MAX;
         
         // The accumulator received enough data to start
         while (accum.ready()) {
@@ -67,8 +92,11 @@ int main(int argc, char** argv) {
 
                 // Define t1 but don't use to localize repeated points
                 t1 = std::max(t2 - delta, loc.last_time_updated);
-                // Check if interval has enough field of view
-                if (t2 - t1 < delta - 1e-6) break;
+                // Check if interval has enough field of view, otherwise wait for it
+                if (t2 - t1 < delta - 1e-6) {
+                    awaited_t2 = t1 + delta - 1e-6;
+                    break;
+                }
 
             // Step 1. LOCALIZATION
 
@@ -76,20 +104,33 @@ int main(int argc, char** argv) {
                 loc.propagate_to(t2);
 
                 // Compensated pointcloud given a path
-                Points compensated = comp.compensate(t1, t2);
-                Points ds_compensated = comp.downsample(compensated);
-                if (ds_compensated.size() < Config.MAX_POINTS2MATCH) break; 
+                Points compensated, ds_compensated;
+                // Only compensate the points that survive downsampling (full resolution later, if needed)
+                if (Config.downsample_before_deskew) ds_compensated = comp.compensate_downsampled(t1, t2);
+                else {
+                    compensated = comp.compensate(t1, t2);
+                    ds_compensated = comp.downsample(compensated);
+                }
+
+                publish.trajectory(loc.trajectory());
+                // Too few points to localize, wait for new data instead of retrying the same window
+                if (ds_compensated.size() < Config.MAX_POINTS2MATCH) {
+                    awaited_t2 = t2 + delta;
+                    break;
+                }
 
                 // Localize points in map
                 loc.correct(ds_compensated, t2);
+
+                // Try the following window without waiting
+                awaited_t2 = -DBL_MAX;
                 State Xt2 = loc.latest_state();
-                accum.add(Xt2, t2);
                 publish.state(Xt2, false);
                 publish.tf(Xt2);
 
                 // Publish pointcloud used to localize
-                Points global_compensated = Xt2 * Xt2.I_Rt_L() * compensated;
-                Points global_ds_compensated = Xt2 * Xt2.I_Rt_L() * ds_compensated;
+                RotTransl Xt2_L = Xt2 * Xt2.I_Rt_L();
+                Points global_ds_compensated = Xt2_L * ds_compensated;
                 publish.pointcloud(global_ds_compensated, true);
 
                 // Publish updated extrinsics
@@ -100,15 +141,18 @@ int main(int argc, char** argv) {
                 // Add updated points to map (mapping online)
                 if (Config.mapping_online) {
                     map.add(global_ds_compensated, t2, true);
-                    if (Config.high_quality_publish) publish.pointcloud(global_compensated, false);                    
+                    if (Config.high_quality_publish) {
+                        if (Config.downsample_before_deskew) compensated = comp.compensate(t1, t2);
+                        Points global_compensated = Xt2_L * compensated;
+                        publish.pointcloud(global_compensated, false);
+                    }
                     else publish.pointcloud(global_ds_compensated, false);                    
                 }
                 // Add updated points to map (mapping offline)
                 else if (map.hasToMap(t2)) {
-                    State Xt2 = loc.latest_state();
-                    // Map points at [t2 - FULL_ROTATION_TIME, t2]
+                    // Map points at [t2 - FULL_ROTATION_TIME, t2] (reusing the ones already compensated)
                     Points full_compensated = comp.compensate(t2 - Config.full_rotation_time, t2);
-                    Points global_full_compensated = Xt2 * Xt2.I_Rt_L() * full_compensated;
+                    Points global_full_compensated = Xt2_L * full_compensated;
                     Points global_full_ds_compensated = comp.downsample(global_full_compensated);
 
                     map.add(global_full_ds_compensated, t2, true);
@@ -118,15 +162,13 @@ int main(int argc, char** argv) {
 
             // Step 3. ERASE OLD DATA
 
-                // Empty too old LiDAR points
+                // Empty too old LiDAR points (and the states they needed)
                 accum.clear_lidar(t2 - Config.empty_lidar_time);
+                loc.clear_trajectory(t2 - Config.empty_lidar_time);
 
             // Trick to call break in the middle of the program
             break;
         }
-
-        ros::spinOnce();
-        rate.sleep();
     }
 
     return 0;
@@ -141,6 +183,15 @@ void fill_config(ros::NodeHandle& nh) {
     nh.param<int>("downsample_rate", Config.downsample_rate, 4);
     nh.param<float>("downsample_prec", Config.downsample_prec, 0.2);
     nh.param<bool>("high_quality_publish", Config.high_quality_publish, false);
+    nh.param<bool>("downsample_before_deskew", Config.downsample_before_deskew, false);
+    nh.param<std::string>("downsample_mode", Config.downsample_mode, "centroid");
+    nh.param<int>("downsample_threads", Config.downsample_threads, 1);
+    nh.param<int>("range_image_columns", Config.range_image_columns, 0);
+    nh.param<float>("range_image_smoothness", Config.range_image_smoothness, 0.);
+    nh.param<bool>("print_metrics", Config.print_metrics, false);
+    nh.param<int>("preprocessing_threads", Config.preprocessing_threads, 2);
+    nh.param<int>("threads", Config.threads, 0);
+    nh.param<std::vector<int>>("threads_affinity", Config.threads_affinity, {});
     nh.param<int>("MAX_NUM_ITERS", Config.MAX_NUM_ITERS, 3);
     nh.param<std::vector<double>>("LIMITS", Config.LIMITS, std::vector<double> (23, 0.001));
     nh.param<int>("NUM_MATCH_POINTS", Config.NUM_MATCH_POINTS, 5);
@@ -148,6 +199,13 @@ void fill_config(ros::NodeHandle& nh) {
     nh.param<double>("MAX_DIST_PLANE", Config.MAX_DIST_PLANE, 2.0);
     nh.param<float>("PLANES_THRESHOLD", Config.PLANES_THRESHOLD, 0.1f);
     nh.param<float>("PLANES_CHOOSE_CONSTANT", Config.PLANES_CHOOSE_CONSTANT, 9.0f);
+    nh.param<float>("match_reuse_dist", Config.match_reuse_dist, 0.f);
+    nh.param<float>("match_cache_prec", Config.match_cache_prec, 0.f);
+    nh.param<float>("map_planes_prec", Config.map_planes_prec, 0.f);
+    nh.param<std::string>("map_backend", Config.map_backend, "ikd-tree");
+    nh.param<float>("ivox_prec", Config.ivox_prec, 0.5);
+    nh.param<int>("ivox_neighbours", Config.ivox_neighbours, 7);
+    nh.param<int>("ivox_capacity", Config.ivox_capacity, 20);
     nh.param<std::string>("LiDAR_type", Config.LiDAR_type, "unknown");
     nh.param<double>("LiDAR_noise", Config.LiDAR_noise, 0.001);
     nh.param<double>("min_dist", Config.min_dist, 3.);
@@ -170,6 +228,11 @@ void fill_config(ros::NodeHandle& nh) {
     nh.param<bool>("stamp_beginning", Config.stamp_beginning, false);
     nh.param<std::vector<double>>("/Initialization/times", Config.Initialization.times, {});
     nh.param<std::vector<double>>("/Initialization/deltas", Config.Initialization.deltas, {Config.full_rotation_time});
+    nh.param<std::string>("/LiDAR_fields/intensity", Config.LiDAR_fields.intensity, "intensity");
+    nh.param<std::string>("/LiDAR_fields/time", Config.LiDAR_fields.time, "time");
+    nh.param<std::string>("/LiDAR_fields/range", Config.LiDAR_fields.range, "");
+    nh.param<double>("/LiDAR_fields/time_unit", Config.LiDAR_fields.time_unit, 1.);
+    nh.param<bool>("/LiDAR_fields/relative_time", Config.LiDAR_fields.relative_time, true);
     nh.param<std::vector<float>>("initial_gravity", Config.initial_gravity, {0.0, 0.0, -9.807});
     nh.param<std::vector<float>>("I_Translation_L", Config.I_Translation_L, std::vector<float> (3, 0.));
     nh.param<std::vector<float>>("I_Rotation_L", Config.I_Rotation_L, std::vector<float> (9, 0.));